@@ -36,6 +36,7 @@
 /*
  * Read a 24 bit binary RGB PPM image from standard input
  * Blur this image using modified 3x3 box window (faster)
+ * or a median filter of any radius
  * Write to standard output
  *
  */
@@ -43,9 +44,10 @@
 int main(int argc, char *argv[])
 {
   size_t repeat = 1;  /* default is blur only once */
+  size_t median = 0;  /* default is box blur, not median */
 
   int optVal;
-  while ( (optVal = getopt(argc, argv, "r:h")) != -1 )
+  while ( (optVal = getopt(argc, argv, "r:m:h")) != -1 )
   {
     char c = optVal;
     switch (c)
@@ -53,10 +55,14 @@ int main(int argc, char *argv[])
       case ('r'):
         repeat = atoi(optarg);
         break;
+      case ('m'):
+        median = atoi(optarg);
+        break;
       case ('h'):
-        printf("Usage:    cat input.ppm | %s [-r num] > output.ppm\n"
+        printf("Usage:    cat input.ppm | %s [-r num] [-m radius] > output.ppm\n"
                "  default is blur once (-r 1)\n"
-               "      -r number of times to repeat blurring operation\n",
+               "      -r number of times to repeat blurring operation\n"
+               "      -m median filter with this window radius instead\n",
                argv[0]);
         return 0;  /* exit */
     }
@@ -98,11 +104,23 @@ int main(int argc, char *argv[])
 
   Image8_t *tmp;
 
+  /* column histograms for the median filter */
+  uint16_t *medianTmp = malloc( sizeof(uint16_t) * 272 * width );
+
   while (repeat--)
   {
-    BlurImage33Fast(ptrRedDest, ptrRedSrc);
-    BlurImage33Fast(ptrGreenDest, ptrGreenSrc);
-    BlurImage33Fast(ptrBlueDest, ptrBlueSrc);
+    if (median)
+    {
+      MedianFilterImage(ptrRedDest, medianTmp, ptrRedSrc, median);
+      MedianFilterImage(ptrGreenDest, medianTmp, ptrGreenSrc, median);
+      MedianFilterImage(ptrBlueDest, medianTmp, ptrBlueSrc, median);
+    }
+    else
+    {
+      BlurImage33Fast(ptrRedDest, ptrRedSrc);
+      BlurImage33Fast(ptrGreenDest, ptrGreenSrc);
+      BlurImage33Fast(ptrBlueDest, ptrBlueSrc);
+    }
 
     tmp = ptrRedDest;
     ptrRedDest = ptrRedSrc;
@@ -130,6 +148,7 @@ int main(int argc, char *argv[])
   IMAGE8FREE( redBlur )
   IMAGE8FREE( greenBlur )
   IMAGE8FREE( blueBlur )
+  free(medianTmp);
 
   return 0;
 }
@@ -32,6 +32,9 @@
 #include "embedcv.h"
 
 
+/* most lines drawn from the Hough transform */
+#define MAX_HOUGH_LINES 64
+
 
 /*
  * Read a 24 bit binary RGB PPM image from standard input
@@ -46,11 +49,12 @@ int main(int argc, char *argv[])
   enum { ALL, HORIZONTAL, VERTICAL, COMBINED } pickOut = COMBINED; /* default */
   int    showHough = 0, transformHough = 0;
   size_t threshHough = 0;
+  size_t threshCanny = 0;  /* default is no Canny edge thinning */
 
   /* how much to right shift the squared edge magnitudes */
   size_t shift = 5;  /* default */
   int optVal;
-  while ( (optVal = getopt(argc, argv, "axyztl:s:h")) != -1 )
+  while ( (optVal = getopt(argc, argv, "axyztl:c:s:h")) != -1 )
   {
     char c = optVal;
     if (c == 'a')
@@ -78,6 +82,10 @@ int main(int argc, char *argv[])
       showHough = 1;
       threshHough = atoi(optarg);
     }
+    else if (c == 'c')
+    {
+      threshCanny = atoi(optarg);
+    }
     else if (c == 's')
     {
       shift = atoi(optarg);
@@ -86,13 +94,14 @@ int main(int argc, char *argv[])
     {
       printf("Usage:    "
              "cat input.ppm | "
-             "%s [-a|-x|-y|-z] [-l number] [-s number] > "
+             "%s [-a|-x|-y|-z] [-c number] [-l number] [-s number] > "
              "output.ppm\n"
              "  how edges are output (default is -z)\n"
              "      -a show -y as red, -x as green, luma as blue\n"
              "      -x only show horizontal edges (from vertical kernel)\n"
              "      -y only show vertical edges (from horizontal kernel)\n"
              "      -z show combined edges\n"
+             "      -c thin combined edges with Canny, high threshold\n"
              "  optionally overlay Hough lines (only for combined edges)\n"
              "      -l show Hough detected edges with threshold\n"
              "      -t do not output edge image but instead Hough transform\n"
@@ -159,7 +168,18 @@ int main(int argc, char *argv[])
   memset( outH2.data, 0, houghImg.width * houghImg.height );
   if (pickOut == COMBINED)
   {
-    EdgeImagesToSS(&aImg, &edgeXImg, &edgeYImg, shift);
+    if (threshCanny)
+    {
+      /* thin edges, weak edges at half the strong threshold */
+      uint32_t *cannyStack = malloc( sizeof(uint32_t) * width * height );
+      CannyEdges(&aImg, cannyStack, &edgeXImg, &edgeYImg,
+                 threshCanny >> 1, threshCanny, 0xff);
+      free(cannyStack);
+    }
+    else
+    {
+      EdgeImagesToSS(&aImg, &edgeXImg, &edgeYImg, shift);
+    }
 
     /* optionally overlay the Hough lines */
     if (showHough)
@@ -197,21 +217,19 @@ int main(int argc, char *argv[])
         ConvertIntegralFeatureImage(&outH, &houghImg, 0);
       }
 
-      const size_t *himg = houghImg.data;
-      size_t theta, radius;
-      for (radius = 0; radius < houghImg.height; ++radius)
+      /* strongest lines with nearby weaker duplicates suppressed */
+      HoughPeak_t peaks[ MAX_HOUGH_LINES ];
+      const size_t numPeaks = HoughPeaks(peaks, MAX_HOUGH_LINES,
+                                         &houghImg, threshHough, 2, 2);
+      size_t i;
+      for (i = 0; i < numPeaks; ++i)
       {
-        for (theta = 0; theta < 128; ++theta)
-        {
-          if (*himg++ > threshHough)
-          {
-            DrawHoughLine(&cImg, width >> 1, height >> 1, theta, radius, 0xff);
+        DrawHoughLine(&cImg, width >> 1, height >> 1,
+                      peaks[i].theta, peaks[i].radius, 0xff);
 
-            if (transformHough)
-            {
-              outH2.data[ (radius << 7) + theta ] = 0xff;
-            }
-          }
+        if (transformHough)
+        {
+          outH2.data[ (peaks[i].radius << 7) + peaks[i].theta ] = 0xff;
         }
       }
     }
@@ -32,12 +32,16 @@
 #include "embedcv.h"
 
 
+/* most cascade detections drawn */
+#define MAX_DETECTIONS 256
+
 
 /*
  * Read a 24 bit binary RGB PPM image from standard input
  * Convert to YCbCr, we are only interested in the luma channel
  * Calculate integral image transform of luma image
  * Calculate images for up/down and left/right features
+ * Optionally draw boxes around windows accepted by a feature cascade
  * Write to standard output, red is left/right, green is up/down, blue is luma
  *
  */
@@ -48,11 +52,17 @@ int main(int argc, char *argv[])
   size_t shiftoffset;    /* automatic scaling offset */
   size_t boxSize = 8;    /* default size of small dimension of feature boxes */
 
+  const char *cascadeFile = 0;  /* optional binary cascade file */
+
   int optVal;
-  while ( (optVal = getopt(argc, argv, "p:s:a:h")) != -1 )
+  while ( (optVal = getopt(argc, argv, "c:p:s:a:h")) != -1 )
   {
     char c = optVal;
-    if (c == 'p')
+    if (c == 'c')
+    {
+      cascadeFile = optarg;
+    }
+    else if (c == 'p')
     {
       boxSize = atoi(optarg);
     }
@@ -68,7 +78,10 @@ int main(int argc, char *argv[])
     else if (c == 'h')
     {
       printf("Usage:    "
-             "cat input.ppm | %s [-p size] [-s shift|-a offset] > output.ppm\n"
+             "cat input.ppm | %s [-c file] [-p size] [-s shift|-a offset] "
+             "> output.ppm\n"
+             "  detect objects and draw boxes into the luma (blue) channel\n"
+             "      -c binary cascade file\n"
              "  size of feature boxes (default -p 8)\n"
              "      -p number pixels of box small dimension\n"
              "  reduce feature magnitudes by a power of 2 (default is -s 5)\n"
@@ -116,6 +129,52 @@ int main(int argc, char *argv[])
   IMAGE32MALLOC( iiImg, width, height )
   IntegralImage(&iiImg, &lumaImg);
 
+  /* cascade detections */
+  if (cascadeFile)
+  {
+    FILE *cascadeIn = fopen(cascadeFile, "rb");
+    size_t winWidth, winHeight, numStages, numFeatures;
+
+    if ( cascadeIn
+         && ReadIntegralFeatureCascadeHead(&winWidth, &winHeight,
+                                           &numStages, &numFeatures,
+                                           cascadeIn) )
+    {
+      CASCADEMALLOC( cascade, winWidth, winHeight, numStages, numFeatures )
+
+      if (ReadIntegralFeatureCascade(&cascade, cascadeIn))
+      {
+        IntegralDetection_t detect[ MAX_DETECTIONS ];
+        size_t numDetect = IntegralFeatureCascadeDetect(detect,
+                                                        MAX_DETECTIONS,
+                                                        &iiImg,
+                                                        &cascade,
+                                                        2,
+                                                        2);
+        if (numDetect > MAX_DETECTIONS)
+        {
+          numDetect = MAX_DETECTIONS;
+        }
+
+        size_t i;
+        for (i = 0; i < numDetect; ++i)
+        {
+          DrawImageBoundingBox(&lumaImg,
+                               detect[i].x, detect[i].y,
+                               detect[i].width, detect[i].height,
+                               0xff);
+        }
+      }
+
+      CASCADEFREE( cascade )
+    }
+
+    if (cascadeIn)
+    {
+      fclose(cascadeIn);
+    }
+  }
+
   /* dense feature images, probably never do this in practice */
   const size_t boxStep = 1;
 
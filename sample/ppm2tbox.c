@@ -45,18 +45,15 @@
  * The intersection points are identified and placed in an array. All object
  * detection proceeds from this array. The images are no longer necessary.
  *
- * While the list is a good idea (maybe), the implementation is not. It is very
- * inefficient. This is a hack as the object detection infrastructure code has
- * not been written yet. Core library code will not be implemented this way.
+ * The points are sorted into a uniform grid so that counting the neighbors of
+ * a point only looks at nearby grid cells. Object points are then picked by
+ * greedy non-maximum suppression over the same grid.
  *
  * The value of this is to show how things can possibly work.
  *
  */
 
 
-#define MAX_FEATURE_POINTS 2048
-
-
 int main(int argc, char *argv[])
 {
   size_t objThreshold = 8;   /* default of four points inside window */
@@ -109,106 +106,85 @@ int main(int argc, char *argv[])
   /* no need to read from stream anymore */
   fclose(stdIn);
 
+  /* count intersection points (all points with red and green at 0xff) */
+  size_t numPoints = 0;
+  size_t colIdx, rowIdx, idx;
+  for (idx = 0; idx < width * height; idx++)
+  {
+    if ( redImg.data[idx] == 0xff && greenImg.data[idx] == 0xff )
+    {
+      numPoints++;
+    }
+  }
+
   /* arrays for storing intersection points */
-  size_t featureCol[ MAX_FEATURE_POINTS ];
-  size_t featureRow[ MAX_FEATURE_POINTS ];
-  size_t featureCount[ MAX_FEATURE_POINTS ];
+  size_t *featureCol   = malloc(sizeof(size_t) * (numPoints + 1));
+  size_t *featureRow   = malloc(sizeof(size_t) * (numPoints + 1));
+  size_t *featureIdx   = malloc(sizeof(size_t) * (numPoints + 1));
+  uint8_t *featureFlag = malloc(sizeof(uint8_t) * (numPoints + 1));
   size_t numFeatures = 0;
 
   /* determine intersection points and put in array */
-  size_t numPoints = 0;
-  size_t colIdx, rowIdx, idx = 0;
+  idx = 0;
   for (rowIdx = 0; rowIdx < height; rowIdx++)
   {
     for (colIdx = 0; colIdx < width; colIdx++)
     {
-      /* look for all points with red and green at 0xff */
       if ( redImg.data[idx] == 0xff && greenImg.data[idx] == 0xff )
       {
-        numPoints++;
-
-        /* only store up to maximum number of feature points - beyond this,
-         * object detection would become overwhelmed anyway - it means that
-         * upstream in the image processing pipeline, that either the feature
-         * scale should be changed or the thresholding more aggressive
-         */
-        if (numFeatures < MAX_FEATURE_POINTS)
-        {
-          featureCol[numFeatures] = colIdx;
-          featureRow[numFeatures] = rowIdx;
-          featureCount[numFeatures] = 0;
-          numFeatures++;
-        }
+        featureCol[numFeatures] = colIdx;
+        featureRow[numFeatures] = rowIdx;
+        numFeatures++;
       }
       idx++;
     }
   }
 
-  /* determine number of neighbor points (no sorting, very inefficient) */
-  size_t ptCol, ptRow, colDist, rowDist, otherIdx;
-  for (idx = 0; idx < numFeatures; idx++)
+  /* grid cells about as large as the object radius */
+  size_t cellShift = 0;
+  while ( (1u << cellShift) < objRadius )
   {
-    ptCol = featureCol[idx];
-    ptRow = featureRow[idx];
-
-    for (otherIdx = 0; otherIdx < numFeatures; otherIdx++)
-    {
-      colDist = UINTDIFF(ptCol, featureCol[otherIdx]);
-      rowDist = UINTDIFF(ptRow, featureRow[otherIdx]);
-      if ( (colDist + rowDist < objRadius) &&
-           (UintSqrt(colDist * colDist + rowDist * rowDist) < objRadius) )
-      {
-        featureCount[idx]++;
-      }
-    }
+    cellShift++;
   }
 
+  POINTGRIDMALLOC( featureGrid, numPoints + 1, width, height, cellShift )
+  PointGridBuild(&featureGrid, featureCol, featureRow, numFeatures);
+
   /* find all points that exceed the object threshold */
-  int featureActive[ MAX_FEATURE_POINTS ];
   size_t numThreshold = 0;
   for (idx = 0; idx < numFeatures; idx++)
   {
-    if (featureCount[idx] > objThreshold)
+    if (PointGridCount(&featureGrid,
+                       featureCol[idx],
+                       featureRow[idx],
+                       objRadius) > objThreshold)
     {
-      featureCol[numThreshold] = featureCol[idx];
-      featureRow[numThreshold] = featureRow[idx];
-      featureActive[numThreshold] = 1;
-      numThreshold++;
+      featureIdx[numThreshold++] = idx;
     }
   }
 
-  /* for points exceeding the object threshold */
-  size_t numObjects = 0;
-  for (idx = 0; idx < numThreshold; idx++)
-  {
-    if (featureActive[idx])
-    {
-      numObjects++;
-
-      ptCol = featureCol[idx];
-      ptRow = featureRow[idx];
+  /* one object for every point exceeding the threshold, neighbors removed */
+  size_t numObjects = PointGridSuppress(featureIdx,
+                                        featureFlag,
+                                        &featureGrid,
+                                        featureIdx,
+                                        numThreshold,
+                                        objRadius);
 
-      /* mark all neighbor points as inactive */
-      for (otherIdx = 0; otherIdx < numFeatures; otherIdx++)
-      {
-        colDist = UINTDIFF(ptCol, featureCol[otherIdx]);
-        rowDist = UINTDIFF(ptRow, featureRow[otherIdx]);
-        if ( (colDist + rowDist < objRadius) &&
-             (UintSqrt(colDist * colDist + rowDist * rowDist) < objRadius) )
-        {
-          featureActive[otherIdx] = 0;
-        }
-      }
-
-      /* draw a bounding box centered on the point */
-      ptCol = (ptCol < (objRadius >> 1)) ? 0 : ptCol - (objRadius >> 1);
-      ptRow = (ptRow < (objRadius >> 1)) ? 0 : ptRow - (objRadius >> 1);
-      ptCol = (ptCol < width - objRadius) ? ptCol : width - objRadius;
-      ptRow = (ptRow < width - objRadius) ? ptRow : width - objRadius;
-      DrawImageBoundingBox(&redImg, ptCol, ptRow, objRadius, objRadius, 0xff);
-      DrawImageBoundingBox(&greenImg, ptCol, ptRow, objRadius, objRadius, 0xff);
-      DrawImageBoundingBox(&blueImg, ptCol, ptRow, objRadius, objRadius, 0xff);
-    }
+  size_t ptCol, ptRow;
+  for (idx = 0; idx < numObjects; idx++)
+  {
+    ptCol = featureCol[ featureIdx[idx] ];
+    ptRow = featureRow[ featureIdx[idx] ];
+
+    /* draw a bounding box centered on the point */
+    ptCol = (ptCol < (objRadius >> 1)) ? 0 : ptCol - (objRadius >> 1);
+    ptRow = (ptRow < (objRadius >> 1)) ? 0 : ptRow - (objRadius >> 1);
+    ptCol = (ptCol < width - objRadius) ? ptCol : width - objRadius;
+    ptRow = (ptRow < width - objRadius) ? ptRow : width - objRadius;
+    DrawImageBoundingBox(&redImg, ptCol, ptRow, objRadius, objRadius, 0xff);
+    DrawImageBoundingBox(&greenImg, ptCol, ptRow, objRadius, objRadius, 0xff);
+    DrawImageBoundingBox(&blueImg, ptCol, ptRow, objRadius, objRadius, 0xff);
   }
 
   /* show some information about object detection */
@@ -232,6 +208,13 @@ int main(int argc, char *argv[])
   WritePPM888(stdOut, &redImg, &greenImg, &blueImg);
   fclose(stdOut);
 
+  /* release feature point memory */
+  POINTGRIDFREE( featureGrid )
+  free(featureCol);
+  free(featureRow);
+  free(featureIdx);
+  free(featureFlag);
+
   /* release image memory */
   IMAGE8FREE( redImg )
   IMAGE8FREE( greenImg )
@@ -0,0 +1,357 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/* variance of a new mode is 15^2 in 1/16 units */
+#define BACKGROUND_INIT_VARIANCE ( 225 << 4 )
+
+/* variance never shrinks below 2^2 in 1/16 units so noise is tolerated */
+#define BACKGROUND_MIN_VARIANCE ( 4 << 4 )
+
+/* modes with this much cumulative weight (3/4 of 1.0) are the background */
+#define BACKGROUND_WEIGHT 49152
+
+
+/*
+ * Move a value toward a target by a fraction 2^-rateShift of the difference
+ *
+ */
+static uint32_t BackgroundBlend (const uint32_t value,
+                                 const uint32_t target,
+                                 const size_t   rateShift)
+{
+  return (target > value) ? value + ((target - value) >> rateShift)
+                          : value - ((value - target) >> rateShift);
+}
+
+
+/*
+ * Update the mean and variance of one Gaussian with a new sample
+ *
+ * The mean is in 1/256 units and the variance in 1/16 units. The squared
+ * distance of the sample from the old mean is returned in 1/65536 units.
+ *
+ */
+static uint32_t BackgroundGaussian (uint16_t     *inoutMean,
+                                    uint16_t     *inoutVariance,
+                                    const uint8_t sample,
+                                    const size_t  rateShift)
+{
+  const uint32_t value  = (uint32_t)sample << 8;
+  const uint32_t diff   = UINTDIFF(value, *inoutMean);
+  const uint32_t diffSq = diff * diff;  /* less than 2^32 */
+
+  uint32_t variance;
+
+  *inoutMean = BackgroundBlend(*inoutMean, value, rateShift);
+
+  variance = BackgroundBlend(*inoutVariance, diffSq >> 12, rateShift);
+
+  if (variance < BACKGROUND_MIN_VARIANCE)
+  {
+    variance = BACKGROUND_MIN_VARIANCE;
+  }
+
+  *inoutVariance = (variance > 0xffff) ? 0xffff : variance;
+
+  return diffSq;
+}
+
+
+/*
+ * Single Gaussian model update of one sample, returns 1 if foreground
+ *
+ */
+static int BackgroundSingle (BackgroundModel_t *inoutModel,
+                             const size_t       idx,
+                             const uint8_t      sample,
+                             const size_t       rateShift,
+                             const uint64_t     thresholdSq)
+{
+  const uint64_t variance = inoutModel->variance[idx];
+
+  const uint32_t diffSq = BackgroundGaussian(inoutModel->mean + idx,
+                                             inoutModel->variance + idx,
+                                             sample,
+                                             rateShift);
+
+  /* compare squared distance with threshold^2 * variance, both 1/65536 */
+  return (uint64_t)diffSq > ((thresholdSq * variance) << 4);
+}
+
+
+/*
+ * Mixture of Gaussians model update of one sample, returns 1 if foreground
+ *
+ * The modes of every sample are kept in order of decreasing weight.
+ *
+ */
+static int BackgroundMixture (BackgroundModel_t *inoutModel,
+                              const size_t       idx,
+                              const uint8_t      sample,
+                              const size_t       rateShift,
+                              const uint64_t     thresholdSq)
+{
+  const size_t   numModes = inoutModel->numberModes;
+  const uint32_t value    = (uint32_t)sample << 8;
+
+  uint16_t *mean     = inoutModel->mean + idx * numModes;
+  uint16_t *variance = inoutModel->variance + idx * numModes;
+  uint16_t *weight   = inoutModel->weight + idx * numModes;
+
+  uint32_t diff, accumWeight = 0;
+  uint16_t swapTmp;
+  size_t   k, match = numModes;
+  int      foreground = 1;
+
+  /* first mode in order of weight within the threshold of the sample */
+  for (k = 0; k < numModes; ++k)
+  {
+    diff = UINTDIFF(value, mean[k]);
+
+    if ( (uint64_t)diff * diff
+         <= ((thresholdSq * variance[k]) << 4) )
+    {
+      match = k;
+      break;
+    }
+
+    accumWeight += weight[k];
+  }
+
+  /* matching one of the heaviest modes is background */
+  if ( (match < numModes) && (accumWeight < BACKGROUND_WEIGHT) )
+  {
+    foreground = 0;
+  }
+
+  /* all weights decay, matched mode gains */
+  for (k = 0; k < numModes; ++k)
+  {
+    weight[k] -= weight[k] >> rateShift;
+  }
+
+  if (match < numModes)
+  {
+    weight[match] += (0xffff - weight[match]) >> rateShift;
+
+    BackgroundGaussian(mean + match, variance + match, sample, rateShift);
+  }
+  else
+  {
+    /* replace the lightest mode with a new one at the sample */
+    match           = numModes - 1;
+    mean[match]     = value;
+    variance[match] = BACKGROUND_INIT_VARIANCE;
+    weight[match]   = 0xffff >> rateShift;
+  }
+
+  /* only the changed mode can be out of order */
+  for (k = match; (k > 0) && (weight[k] > weight[k - 1]); --k)
+  {
+    swapTmp         = mean[k];
+    mean[k]         = mean[k - 1];
+    mean[k - 1]     = swapTmp;
+
+    swapTmp         = variance[k];
+    variance[k]     = variance[k - 1];
+    variance[k - 1] = swapTmp;
+
+    swapTmp         = weight[k];
+    weight[k]       = weight[k - 1];
+    weight[k - 1]   = swapTmp;
+  }
+
+  return foreground;
+}
+
+
+/*
+ * Initialize every mode of the model from one array of samples
+ *
+ */
+static void BackgroundInitSamples (BackgroundModel_t *outModel,
+                                   const uint8_t     *inSamples)
+{
+  const size_t numModes = outModel->numberModes;
+
+  uint16_t *ptrMean     = outModel->mean;
+  uint16_t *ptrVariance = outModel->variance;
+  uint16_t *ptrWeight   = outModel->weight;
+
+  size_t k;
+
+  NORMAL_LOOP( outModel->numberSamples,
+
+      for (k = 0; k < numModes; ++k)
+      {
+        *ptrMean++     = k ? 0 : (uint16_t)*inSamples << 8;
+        *ptrVariance++ = BACKGROUND_INIT_VARIANCE;
+
+        if (ptrWeight)
+        {
+          *ptrWeight++ = k ? 0 : 0xffff;
+        }
+      }
+
+      inSamples++;
+  )
+}
+
+
+/*
+ * Update the model with an array of samples and mark the foreground pixels
+ *
+ */
+static void BackgroundUpdateSamples (Image8_t          *outMask,
+                                     BackgroundModel_t *inoutModel,
+                                     const uint8_t     *inSamples,
+                                     const size_t       channels,
+                                     const size_t       rateShift,
+                                     const size_t       threshold,
+                                     const uint8_t      value)
+{
+  const uint64_t thresholdSq = (uint64_t)threshold * threshold;
+
+  int (*updateSample)(BackgroundModel_t *, const size_t, const uint8_t,
+                      const size_t, const uint64_t)
+      = (inoutModel->numberModes > 1) ? BackgroundMixture : BackgroundSingle;
+
+  uint8_t *ptrMask = outMask ? outMask->data : 0;
+
+  size_t idx = 0;
+  size_t c;
+  int    foreground;
+
+  NORMAL_LOOP( inoutModel->numberSamples / channels,
+
+      foreground = 0;
+
+      for (c = 0; c < channels; ++c)
+      {
+        foreground |= updateSample(inoutModel, idx, *inSamples++,
+                                   rateShift, thresholdSq);
+        idx++;
+      }
+
+      if (ptrMask)
+      {
+        *ptrMask++ = foreground ? value : 0;
+      }
+  )
+}
+
+
+/*
+ * Initialize a background model from an image
+ *
+ * The first mode of every pixel is centered on the pixel value with a
+ * generous variance. Any other modes of a mixture start with no weight.
+ *
+ */
+void BackgroundInit (BackgroundModel_t *outModel,
+                     const Image8_t    *inImg)
+{
+  BackgroundInitSamples(outModel, inImg->data);
+}
+
+
+/*
+ * Initialize a background model from a packed 16 bit CbCr image
+ *
+ * The Cb and Cr channels are modeled independently so the model must have
+ * two samples for every pixel. The channel order does not matter.
+ *
+ */
+void BackgroundInitCbCr (BackgroundModel_t *outModel,
+                         const Image16_t   *inImg)
+{
+  BackgroundInitSamples(outModel, (const uint8_t *) inImg->data);
+}
+
+
+/*
+ * Adaptive background subtraction
+ *
+ * Every pixel has a running Gaussian estimate of its background value. With
+ * one mode this is a single Gaussian. With two or three modes it is the
+ * mixture of Gaussians from:
+ *
+ * Adaptive background mixture models for real-time tracking
+ * by Chris Stauffer and W.E.L. Grimson
+ * IEEE Conference on Computer Vision and Pattern Recognition, 1999
+ *
+ * The mean is in 1/256 units, the variance in 1/16 units and the mixture
+ * weights in 1/65536 units. All arithmetic is integer. The learning rate is
+ * 2^-rateShift so a shift of 5 adapts over roughly 32 frames.
+ *
+ * A pixel is foreground if it is further than threshold/16 standard
+ * deviations from the mean of the single Gaussian. For a mixture, it is
+ * foreground unless it matches one of the heaviest modes making up three
+ * quarters of the total weight. A sample that matches no mode replaces the
+ * lightest one.
+ *
+ * Foreground pixels are set to the mark value and background pixels to zero
+ * in the output mask, which is optional.
+ *
+ */
+void BackgroundUpdate (Image8_t          *outMask,    /* may be null */
+                       BackgroundModel_t *inoutModel,
+                       const Image8_t    *inImg,
+                       const size_t       rateShift,
+                       const size_t       threshold,
+                       const uint8_t      value)
+{
+  BackgroundUpdateSamples(outMask, inoutModel, inImg->data, 1,
+                          rateShift, threshold, value);
+}
+
+
+/*
+ * Adaptive background subtraction of a packed 16 bit CbCr image
+ *
+ * This is identical to BackgroundUpdate() except that the Cb and Cr channels
+ * are modeled independently. A pixel is foreground if either channel is.
+ *
+ */
+void BackgroundUpdateCbCr (Image8_t          *outMask,    /* may be null */
+                           BackgroundModel_t *inoutModel,
+                           const Image16_t   *inImg,
+                           const size_t       rateShift,
+                           const size_t       threshold,
+                           const uint8_t      value)
+{
+  BackgroundUpdateSamples(outMask, inoutModel, (const uint8_t *) inImg->data,
+                          2, rateShift, threshold, value);
+}
@@ -0,0 +1,427 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/*
+ * Binary cascade file format, all values little endian
+ *
+ * header:    'E' 'C' 'V' 'C'
+ *            uint16 window width
+ *            uint16 window height
+ *            uint16 number of stages
+ *            uint16 number of features
+ *
+ * stage:     uint16 number of features
+ *            int32  stage threshold
+ *
+ * feature:   uint8  number of boxes (1 to 3)
+ *            three boxes of uint8 x, y, width, height and int8 weight
+ *            int32  feature threshold
+ *            int16  vote below threshold
+ *            int16  vote at or above threshold
+ *
+ * All stages come first, then all features in stage order.
+ *
+ */
+
+
+/*
+ * Read a little endian value of one to four bytes from a stream
+ *
+ */
+static int ReadCascadeValue (uint32_t    *outValue,
+                             const size_t numBytes,
+                             FILE        *s)
+{
+  uint8_t bytes[4];
+  size_t  i;
+
+  if (fread(bytes, sizeof(uint8_t), numBytes, s) != numBytes)
+  {
+    return 0;
+  }
+
+  *outValue = 0;
+  for (i = numBytes; i > 0; --i)
+  {
+    *outValue = (*outValue << 8) | bytes[i - 1];
+  }
+
+  return 1;
+}
+
+
+/*
+ * Read the header of a binary cascade file
+ *
+ * The header has the window dimensions and the number of stages and features
+ * so storage for the cascade can be allocated before reading the rest of it.
+ *
+ */
+int ReadIntegralFeatureCascadeHead (size_t *outWindowWidth,
+                                    size_t *outWindowHeight,
+                                    size_t *outNumberStages,
+                                    size_t *outNumberFeatures,
+                                    FILE   *s)
+{
+  const uint8_t CASCADE_MAGIC[] = { 'E', 'C', 'V', 'C' };
+  uint8_t       magic[sizeof(CASCADE_MAGIC)];
+  uint32_t      value[4];
+  size_t        i;
+
+  if ( (fread(magic, sizeof(uint8_t), sizeof(magic), s) != sizeof(magic))
+       || memcmp(magic, CASCADE_MAGIC, sizeof(magic)) )
+  {
+    return 0;
+  }
+
+  for (i = 0; i < 4; ++i)
+  {
+    if (! ReadCascadeValue(value + i, 2, s))
+    {
+      return 0;
+    }
+  }
+
+  *outWindowWidth    = value[0];
+  *outWindowHeight   = value[1];
+  *outNumberStages   = value[2];
+  *outNumberFeatures = value[3];
+
+  return 1;
+}
+
+
+/*
+ * Read the stages and features of a binary cascade file after the header
+ *
+ * The cascade must have been allocated with the window dimensions and counts
+ * from the header. Every stage must have at least one feature and the stages
+ * must use exactly all of the features. Every box must be inside the window.
+ *
+ */
+int ReadIntegralFeatureCascade (IntegralFeatureCascade_t *outCascade,
+                                FILE                     *s)
+{
+  IntegralStage_t   *stage   = outCascade->stages;
+  IntegralFeature_t *feature = outCascade->features;
+  IntegralBox_t     *box;
+
+  uint32_t value;
+  size_t   i, j, total = 0;
+
+  for (i = 0; i < outCascade->numberStages; ++i, ++stage)
+  {
+    if (! ReadCascadeValue(&value, 2, s) || ! value)
+    {
+      return 0;
+    }
+    stage->numberFeatures = value;
+    total += value;
+
+    if (! ReadCascadeValue(&value, 4, s))
+    {
+      return 0;
+    }
+    stage->threshold = (int32_t)value;
+  }
+
+  if (total != outCascade->numberFeatures)
+  {
+    return 0;
+  }
+
+  for (i = 0; i < outCascade->numberFeatures; ++i, ++feature)
+  {
+    if (! ReadCascadeValue(&value, 1, s) || ! value || (value > 3))
+    {
+      return 0;
+    }
+    feature->numberBoxes = value;
+
+    for (j = 0, box = feature->box; j < 3; ++j, ++box)
+    {
+      uint8_t bytes[5];
+
+      if (fread(bytes, sizeof(uint8_t), 5, s) != 5)
+      {
+        return 0;
+      }
+
+      box->x      = bytes[0];
+      box->y      = bytes[1];
+      box->width  = bytes[2];
+      box->height = bytes[3];
+      box->weight = (int8_t)bytes[4];
+
+      if ( (j < feature->numberBoxes)
+           && ( (box->x + box->width > outCascade->windowWidth)
+                || (box->y + box->height > outCascade->windowHeight) ) )
+      {
+        return 0;
+      }
+    }
+
+    if (! ReadCascadeValue(&value, 4, s))
+    {
+      return 0;
+    }
+    feature->threshold = (int32_t)value;
+
+    if (! ReadCascadeValue(&value, 2, s))
+    {
+      return 0;
+    }
+    feature->belowVote = (int16_t)value;
+
+    if (! ReadCascadeValue(&value, 2, s))
+    {
+      return 0;
+    }
+    feature->aboveVote = (int16_t)value;
+  }
+
+  return 1;
+}
+
+
+/*
+ * Sum of pixels in a box from the four corners in the integral image
+ *
+ * The corner pointer is one row up and one column left of the box. The
+ * unsigned arithmetic wraps around correctly.
+ *
+ */
+static uint32_t CascadeBoxSum (const uint32_t *ptrCorner,
+                               const size_t    imgWidth,
+                               const size_t    boxWidth,
+                               const size_t    boxHeight)
+{
+  const uint32_t *ptrLower = ptrCorner + boxHeight * imgWidth;
+
+  return ptrLower[boxWidth] + ptrCorner[0]
+             - (ptrCorner[boxWidth] + ptrLower[0]);
+}
+
+
+/*
+ * Evaluate a cascade over an integral image with optional normalization
+ *
+ * If the squared integral image is given, then every feature threshold is
+ * multiplied by the window standard deviation. The deviation is kept in 1/16
+ * pixel value units for precision so the weighted box sum is multiplied by 16
+ * to match. The threshold itself is in whole standard deviations.
+ *
+ */
+static size_t CascadeDetect (IntegralDetection_t            *outDetect,
+                             const size_t                    maxDetect,
+                             const Image32_t                *inImg,
+                             const Image64_t                *inSqImg,
+                             const IntegralFeatureCascade_t *inCascade,
+                             const size_t                    colStep,
+                             const size_t                    rowStep)
+{
+  const size_t width        = inImg->width;
+  const size_t height       = inImg->height;
+  const size_t windowWidth  = inCascade->windowWidth;
+  const size_t windowHeight = inCascade->windowHeight;
+  const size_t windowArea   = windowWidth * windowHeight;
+
+  const IntegralStage_t   *stage;
+  const IntegralFeature_t *feature;
+  const IntegralBox_t     *box;
+  const uint32_t          *ptrWin, *ptrBox;
+  const uint64_t          *ptrWinSq;
+
+  size_t   row, col, i, j;
+  size_t   count = 0;
+  int32_t  value, stageSum;
+  int64_t  sigma = 0;
+  uint64_t sum, sumSq;
+
+  /* the window starts one pixel in from the integral image corner */
+  if ( (windowWidth >= width)
+       || (windowHeight >= height)
+       || ! inCascade->numberStages )
+  {
+    return 0;
+  }
+
+  for (row = 0; row < height - windowHeight; row += rowStep)
+  {
+    for (col = 0; col < width - windowWidth; col += colStep)
+    {
+      ptrWin = inImg->data + row * width + col;
+
+      /* window standard deviation times 16 */
+      if (inSqImg)
+      {
+        ptrWinSq = inSqImg->data + row * width + col;
+
+        sum   = CascadeBoxSum(ptrWin, width, windowWidth, windowHeight);
+        sumSq = ptrWinSq[windowHeight * width + windowWidth] + ptrWinSq[0]
+                    - (ptrWinSq[windowWidth] + ptrWinSq[windowHeight * width]);
+
+        sigma = UintSqrt( ((windowArea * sumSq - sum * sum) << 8)
+                          / (windowArea * windowArea) );
+
+        if (! sigma)
+        {
+          sigma = 1;  /* flat window */
+        }
+      }
+
+      stage    = inCascade->stages;
+      feature  = inCascade->features;
+      stageSum = 0;
+
+      for (i = 0; i < inCascade->numberStages; ++i, ++stage)
+      {
+        stageSum = 0;
+
+        NORMAL_LOOP( stage->numberFeatures,
+
+            value = 0;
+            box   = feature->box;
+
+            for (j = 0; j < feature->numberBoxes; ++j, ++box)
+            {
+              ptrBox = ptrWin + box->y * width + box->x;
+              value += box->weight * (int32_t)CascadeBoxSum(ptrBox,
+                                                            width,
+                                                            box->width,
+                                                            box->height);
+            }
+
+            if (inSqImg)
+            {
+              stageSum += ( ((int64_t)value << 4)
+                            < (int64_t)feature->threshold * sigma )
+                              ? feature->belowVote
+                              : feature->aboveVote;
+            }
+            else
+            {
+              stageSum += (value < feature->threshold) ? feature->belowVote
+                                                       : feature->aboveVote;
+            }
+
+            feature++;
+        )
+
+        /* early rejection */
+        if (stageSum < stage->threshold)
+        {
+          break;
+        }
+      }
+
+      if (i < inCascade->numberStages)
+      {
+        continue;
+      }
+
+      if (count < maxDetect)
+      {
+        outDetect[count].x      = col + 1;
+        outDetect[count].y      = row + 1;
+        outDetect[count].width  = windowWidth;
+        outDetect[count].height = windowHeight;
+        outDetect[count].score  = stageSum - (stage - 1)->threshold;
+      }
+      count++;
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Evaluate a cascade of box features over an integral image
+ *
+ * The detection window slides over the image in steps of colStep and
+ * rowStep. At every position, the stages are evaluated in order. Each weak
+ * classifier votes depending on whether its weighted box sum is below its
+ * threshold. If the sum of votes in a stage is below the stage threshold,
+ * then the window is rejected and no more stages are evaluated. Most windows
+ * are rejected by the first stage or two so the cost is much less than
+ * evaluating every feature everywhere.
+ *
+ * The box sums come directly from four corners of the integral image. So the
+ * thresholds are in units of pixel value sums at the cascade window size.
+ *
+ * Windows accepted by every stage are written to the output list. At most
+ * maxDetect are written. The total number of windows accepted is returned
+ * which may be more than maxDetect.
+ *
+ */
+size_t IntegralFeatureCascadeDetect (IntegralDetection_t            *outDetect,
+                                     const size_t                    maxDetect,
+                                     const Image32_t                *inImg,
+                                     const IntegralFeatureCascade_t *inCascade,
+                                     const size_t                    colStep,
+                                     const size_t                    rowStep)
+{
+  return CascadeDetect(outDetect, maxDetect, inImg, 0, inCascade,
+                       colStep, rowStep);
+}
+
+
+/*
+ * Evaluate a variance normalized cascade of box features
+ *
+ * This is the same as IntegralFeatureCascadeDetect() except that feature
+ * thresholds scale with the standard deviation of the window as in the
+ * Viola and Jones detector, so the features do not depend on the lighting
+ * contrast. The standard deviation costs four more corners per window from
+ * the squared integral image made by IntegralImageSq(). A feature votes below
+ * when its weighted box sum is less than its threshold times the window
+ * standard deviation in pixel values. So the thresholds are in whole standard
+ * deviations.
+ *
+ */
+size_t IntegralFeatureCascadeDetectNorm (IntegralDetection_t            *outDetect,
+                                         const size_t                    maxDetect,
+                                         const Image32_t                *inImg,
+                                         const Image64_t                *inSqImg,
+                                         const IntegralFeatureCascade_t *inCascade,
+                                         const size_t                    colStep,
+                                         const size_t                    rowStep)
+{
+  return CascadeDetect(outDetect, maxDetect, inImg, inSqImg, inCascade,
+                       colStep, rowStep);
+}
@@ -0,0 +1,530 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/* Bresenham circle of radius 3 clockwise from the top, as column and row */
+static const int8_t fastCircle[16][2] = { { 0, -3 }, { 1, -3 }, { 2, -2 },
+                                          { 3, -1 }, { 3, 0 }, { 3, 1 },
+                                          { 2, 2 }, { 1, 3 }, { 0, 3 },
+                                          { -1, 3 }, { -2, 2 }, { -3, 1 },
+                                          { -3, 0 }, { -3, -1 }, { -2, -2 },
+                                          { -1, -3 } };
+
+/* Harris sensitivity k = 41/1024 which is about 0.04 */
+#define HARRIS_K       41
+#define HARRIS_K_SHIFT 10
+
+
+/*
+ * Add a keypoint, if the array is full replace the weakest one
+ *
+ * The array is a heap with the weakest keypoint at the root once it fills up.
+ * Until then, keypoints are simply appended.
+ *
+ */
+static void KeypointInsert (Keypoint_t     *inoutKeypoints,
+                            size_t         *inoutCount,
+                            const size_t    maxKeypoints,
+                            const size_t    col,
+                            const size_t    row,
+                            const uint32_t  score)
+{
+  Keypoint_t tmp;
+  size_t     count = *inoutCount;
+  size_t     i, child;
+
+  if (count < maxKeypoints)
+  {
+    inoutKeypoints[count].col   = col;
+    inoutKeypoints[count].row   = row;
+    inoutKeypoints[count].score = score;
+    *inoutCount = ++count;
+
+    /* heapify everything the moment the array becomes full */
+    if (count == maxKeypoints)
+    {
+      for (i = count >> 1; i > 0; --i)
+      {
+        size_t parent = i - 1;
+
+        while ( (child = 2 * parent + 1) < count )
+        {
+          if ( (child + 1 < count)
+               && (inoutKeypoints[child + 1].score
+                   < inoutKeypoints[child].score) )
+          {
+            child++;
+          }
+
+          if (inoutKeypoints[parent].score <= inoutKeypoints[child].score)
+          {
+            break;
+          }
+
+          tmp = inoutKeypoints[parent];
+          inoutKeypoints[parent] = inoutKeypoints[child];
+          inoutKeypoints[child]  = tmp;
+          parent = child;
+        }
+      }
+    }
+
+    return;
+  }
+
+  if ( (! maxKeypoints) || (score <= inoutKeypoints[0].score) )
+  {
+    return;
+  }
+
+  /* replace the root and sift it down */
+  i = 0;
+
+  while ( (child = 2 * i + 1) < count )
+  {
+    if ( (child + 1 < count)
+         && (inoutKeypoints[child + 1].score < inoutKeypoints[child].score) )
+    {
+      child++;
+    }
+
+    if (score <= inoutKeypoints[child].score)
+    {
+      break;
+    }
+
+    inoutKeypoints[i] = inoutKeypoints[child];
+    i = child;
+  }
+
+  inoutKeypoints[i].col   = col;
+  inoutKeypoints[i].row   = row;
+  inoutKeypoints[i].score = score;
+}
+
+
+/*
+ * Non-maximum suppression of one row of corner scores
+ *
+ * A score is kept if it is not smaller than any of its eight neighbors.
+ * Neighbors earlier in raster order must be strictly smaller so only one
+ * corner survives on a plateau of equal scores.
+ *
+ */
+static void KeypointSuppressRow (Keypoint_t     *inoutKeypoints,
+                                 size_t         *inoutCount,
+                                 const size_t    maxKeypoints,
+                                 const uint32_t *inScoreUp,
+                                 const uint32_t *inScore,
+                                 const uint32_t *inScoreDown,
+                                 const size_t    width,
+                                 const size_t    row,
+                                 const size_t    border)
+{
+  size_t   col;
+  uint32_t score;
+
+  for (col = border; col < width - border; ++col)
+  {
+    score = inScore[col];
+
+    if ( score
+         && (score >  inScoreUp[col - 1])
+         && (score >  inScoreUp[col])
+         && (score >  inScoreUp[col + 1])
+         && (score >  inScore[col - 1])
+         && (score >= inScore[col + 1])
+         && (score >= inScoreDown[col - 1])
+         && (score >= inScoreDown[col])
+         && (score >= inScoreDown[col + 1]) )
+    {
+      KeypointInsert(inoutKeypoints, inoutCount, maxKeypoints, col, row,
+                     score);
+    }
+  }
+}
+
+
+/*
+ * FAST corner detector
+ *
+ * A pixel is a corner if a contiguous arc of the 16 pixels on a circle of
+ * radius 3 around it are all brighter than the pixel plus the threshold or
+ * all darker than the pixel minus the threshold. The arc length is 9 for
+ * FAST-9 or 12 for FAST-12. This is from:
+ *
+ * Machine learning for high-speed corner detection
+ * by Edward Rosten and Tom Drummond
+ * European Conference on Computer Vision 2006
+ *
+ * The four compass points of the circle are tested first. Any arc of 9
+ * contains at least two of them and any arc of 12 at least three, so most
+ * pixels are rejected after four comparisons. The remaining pixels compare
+ * the whole circle into bit masks of brighter and darker pixels. Contiguous
+ * arcs are found with a few shifts and ands of the masks instead of walking
+ * the circle.
+ *
+ * The score of a corner is the sum of the absolute differences beyond the
+ * threshold over the brighter or darker pixels of the circle. Corners that are
+ * not a maximum of the score in their 3x3 neighborhood are suppressed. Pixels
+ * within 3 of the image border are never corners.
+ *
+ * At most maxKeypoints corners are kept. If more are found, the strongest
+ * are kept and the order of the keypoints is arbitrary. Otherwise they are in
+ * raster order. The number of keypoints stored is returned.
+ *
+ */
+size_t FastCorners (Keypoint_t     *outKeypoints,
+                    const size_t    maxKeypoints,
+                    const Image8_t *inImg,
+                    const uint8_t   threshold,
+                    const size_t    arcLength)   /* 9 or 12 */
+{
+  const size_t width    = inImg->width;
+  const size_t height   = inImg->height;
+  const size_t minCount = (arcLength > 9) ? 3 : 2;
+
+  /* scores of the last three rows */
+  uint32_t scoreBuf[3][width];
+
+  ptrdiff_t offset[16];
+
+  const uint8_t *ptrIn;
+
+  size_t   count = 0;
+  size_t   row, col, i, numBright, numDark;
+  uint32_t bright, dark, arc, score;
+  int      center, value, low, high;
+
+  if ( (width < 7) || (height < 7) )
+  {
+    return 0;
+  }
+
+  for (i = 0; i < 16; ++i)
+  {
+    offset[i] = (ptrdiff_t)fastCircle[i][1] * width + fastCircle[i][0];
+  }
+
+  memset(scoreBuf, 0, sizeof(scoreBuf));
+
+  /* the row after the last scored row is all zero */
+  for (row = 3; row <= height - 3; ++row)
+  {
+    uint32_t *ptrScore = scoreBuf[row % 3];
+
+    memset(ptrScore, 0, sizeof(uint32_t) * width);
+
+    if (row < height - 3)
+    {
+      ptrIn = inImg->data + row * width + 3;
+
+      for (col = 3; col < width - 3; ++col, ++ptrIn)
+      {
+        center = *ptrIn;
+        low    = center - threshold;
+        high   = center + threshold;
+
+        /* high speed test on the compass points */
+        numBright = numDark = 0;
+
+        for (i = 0; i < 16; i += 4)
+        {
+          value = ptrIn[ offset[i] ];
+          numBright += (value > high);
+          numDark   += (value < low);
+        }
+
+        if ( (numBright < minCount) && (numDark < minCount) )
+        {
+          continue;
+        }
+
+        /* whole circle into bit masks */
+        bright = dark = 0;
+
+        for (i = 0; i < 16; ++i)
+        {
+          value = ptrIn[ offset[i] ];
+          bright |= (uint32_t)(value > high) << i;
+          dark   |= (uint32_t)(value < low) << i;
+        }
+
+        /* the circle wraps around so repeat the masks */
+        bright |= bright << 16;
+        dark   |= dark << 16;
+
+        /* arcs of 9 or 12 from arcs of 1, 2, 4 and 8 */
+        score = 0;
+
+        for (i = 0; i < 2; ++i)
+        {
+          uint32_t mask = i ? dark : bright;
+          uint32_t run2 = mask & (mask >> 1);
+          uint32_t run4 = run2 & (run2 >> 2);
+          uint32_t run8 = run4 & (run4 >> 4);
+
+          arc = (arcLength > 9) ? run8 & (run4 >> 8) : run8 & (mask >> 8);
+
+          if (arc & 0xffff)
+          {
+            size_t k;
+
+            for (k = 0; k < 16; ++k)
+            {
+              if (mask & (1u << k))
+              {
+                value  = ptrIn[ offset[k] ];
+                score += i ? low - value : value - high;
+              }
+            }
+          }
+        }
+
+        ptrScore[col] = score;
+      }
+    }
+
+    if (row > 3)
+    {
+      KeypointSuppressRow(outKeypoints, &count, maxKeypoints,
+                          scoreBuf[(row - 2) % 3], scoreBuf[(row - 1) % 3],
+                          scoreBuf[row % 3], width, row - 1, 3);
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Add or remove one row of gradient products to the column sums
+ *
+ */
+static void CornerColumnSums (uint32_t       *inoutSumXX,
+                              int32_t        *inoutSumXY,
+                              uint32_t       *inoutSumYY,
+                              const int16_t  *inEdgeX,
+                              const int16_t  *inEdgeY,
+                              const size_t    width,
+                              const int       subtract)
+{
+  int32_t gx, gy;
+
+  /* the border columns of the Sobel edge images are not valid */
+  inEdgeX++;
+  inEdgeY++;
+  inoutSumXX++;
+  inoutSumXY++;
+  inoutSumYY++;
+
+  if (subtract)
+  {
+    UNROLL_LOOP( width - 2,
+
+        gx = *inEdgeX++;
+        gy = *inEdgeY++;
+        *inoutSumXX++ -= gx * gx;
+        *inoutSumXY++ -= gx * gy;
+        *inoutSumYY++ -= gy * gy;
+    )
+  }
+  else
+  {
+    UNROLL_LOOP( width - 2,
+
+        gx = *inEdgeX++;
+        gy = *inEdgeY++;
+        *inoutSumXX++ += gx * gx;
+        *inoutSumXY++ += gx * gy;
+        *inoutSumYY++ += gy * gy;
+    )
+  }
+}
+
+
+/*
+ * Harris and Shi-Tomasi corner detector
+ *
+ * The structure tensor of every pixel is the sum of the gradient products
+ * IxIx, IxIy and IyIy over a square window of radius pixels around it. The
+ * Harris measure is from:
+ *
+ * A combined corner and edge detector
+ * by Chris Harris and Mike Stephens
+ * Proceedings of the 4th Alvey Vision Conference 1988
+ *
+ * and is det - k trace^2 with k about 0.04. The score is the square root of
+ * the positive measure so it has the same units as the minimum eigenvalue
+ * measure from:
+ *
+ * Good features to track
+ * by Jianbo Shi and Carlo Tomasi
+ * IEEE Conference on Computer Vision and Pattern Recognition 1994
+ *
+ * The products are never stored. Running column sums over the window rows are
+ * updated by adding the row entering the window and subtracting the row
+ * leaving it. A running sum across the columns gives the window sums which
+ * are scored immediately. Only three rows of scores are kept for 3x3
+ * non-maximum suppression. So the extra storage is a few rows whatever the
+ * window size.
+ *
+ * The edge images are from SobelEdges(). Their border pixels are not valid
+ * so windows must lie within one pixel of the image border. Scores below the
+ * threshold are not corners. The radius is at most 15 so all sums fit.
+ *
+ * At most maxKeypoints corners are kept. If more are found, the strongest
+ * are kept and the order of the keypoints is arbitrary. Otherwise they are in
+ * raster order. The number of keypoints stored is returned.
+ *
+ */
+size_t HarrisCorners (Keypoint_t             *outKeypoints,
+                      const size_t            maxKeypoints,
+                      const Image16_t        *inImgEdgeX,
+                      const Image16_t        *inImgEdgeY,
+                      const size_t            radius,     /* up to 15 */
+                      const uint32_t          threshold,
+                      const EcvCornerMeasure  measure)
+{
+  const size_t width    = inImgEdgeX->width;
+  const size_t height   = inImgEdgeX->height;
+  const size_t diameter = 2 * radius + 1;
+  const size_t first    = radius + 1;           /* first row and column */
+  const size_t lastRow  = height - 2 - radius;
+  const size_t lastCol  = width - 2 - radius;
+
+  const int16_t *dataX = (const int16_t *) inImgEdgeX->data;
+  const int16_t *dataY = (const int16_t *) inImgEdgeY->data;
+
+  /* window column sums of the gradient products */
+  uint32_t colXX[width];
+  int32_t  colXY[width];
+  uint32_t colYY[width];
+
+  /* scores of the last three rows */
+  uint32_t scoreBuf[3][width];
+
+  size_t   count = 0;
+  size_t   row, col;
+  uint32_t sumXX, sumYY, score;
+  int32_t  sumXY;
+  uint64_t trace, diff;
+  int64_t  response;
+
+  if ( (width < diameter + 2) || (height < diameter + 2) )
+  {
+    return 0;
+  }
+
+  memset(colXX, 0, sizeof(colXX));
+  memset(colXY, 0, sizeof(colXY));
+  memset(colYY, 0, sizeof(colYY));
+  memset(scoreBuf, 0, sizeof(scoreBuf));
+
+  /* all window rows except the last of the first window */
+  for (row = 1; row < diameter; ++row)
+  {
+    CornerColumnSums(colXX, colXY, colYY, dataX + row * width,
+                     dataY + row * width, width, 0);
+  }
+
+  /* the row after the last scored row is all zero */
+  for (row = first; row <= lastRow + 1; ++row)
+  {
+    uint32_t *ptrScore = scoreBuf[row % 3];
+
+    memset(ptrScore, 0, sizeof(uint32_t) * width);
+
+    if (row <= lastRow)
+    {
+      CornerColumnSums(colXX, colXY, colYY, dataX + (row + radius) * width,
+                       dataY + (row + radius) * width, width, 0);
+
+      sumXX = sumYY = 0;
+      sumXY = 0;
+
+      for (col = 1; col < diameter; ++col)
+      {
+        sumXX += colXX[col];
+        sumXY += colXY[col];
+        sumYY += colYY[col];
+      }
+
+      for (col = first; col <= lastCol; ++col)
+      {
+        sumXX += colXX[col + radius];
+        sumXY += colXY[col + radius];
+        sumYY += colYY[col + radius];
+
+        trace = (uint64_t)sumXX + sumYY;
+
+        if (ECV_CORNER_MIN_EIGEN == measure)
+        {
+          /* twice the smaller eigenvalue is trace - sqrt(diff^2 + 4 xy^2) */
+          diff  = UINTDIFF(sumXX, sumYY);
+          score = ( trace - UintSqrt64(diff * diff
+                                       + (((uint64_t)((int64_t)sumXY
+                                                      * sumXY)) << 2)) ) >> 1;
+        }
+        else
+        {
+          response = (int64_t)((uint64_t)sumXX * sumYY)
+                     - (int64_t)sumXY * sumXY
+                     - (int64_t)(((trace * trace) >> HARRIS_K_SHIFT)
+                                 * HARRIS_K);
+
+          score = (response > 0) ? UintSqrt64(response) : 0;
+        }
+
+        ptrScore[col] = (score >= threshold) ? score : 0;
+
+        sumXX -= colXX[col - radius];
+        sumXY -= colXY[col - radius];
+        sumYY -= colYY[col - radius];
+      }
+
+      CornerColumnSums(colXX, colXY, colYY, dataX + (row - radius) * width,
+                       dataY + (row - radius) * width, width, 1);
+    }
+
+    if (row > first)
+    {
+      KeypointSuppressRow(outKeypoints, &count, maxKeypoints,
+                          scoreBuf[(row - 2) % 3], scoreBuf[(row - 1) % 3],
+                          scoreBuf[row % 3], width, row - 1, first);
+    }
+  }
+
+  return count;
+}
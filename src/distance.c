@@ -0,0 +1,397 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/* chamfer distances saturate at the largest 16 bit value */
+#define CHAMFER_INFINITY 0xffff
+
+/* smaller of two values */
+#define MINVALUE( v1, v2 ) ( ((v1) < (v2)) ? (v1) : (v2) )
+
+
+/*
+ * Chamfer 3-4 distance transform of a binary image
+ *
+ * The source pixels are the nonzero pixels in the input image. If toZero is
+ * set, then the source pixels are the zero pixels instead. Every output pixel
+ * is the chamfer distance to the nearest source pixel. A horizontal or
+ * vertical step costs 3 and a diagonal step costs 4. So dividing the output
+ * by 3 gives an approximate Euclidean distance in pixels.
+ *
+ * There are two passes over the image. The forward pass propagates distances
+ * down and to the right. The backward pass propagates them up and to the
+ * left. The work per pixel is constant so this is linear in the image size.
+ *
+ * Pixels beyond the image border are not considered. If there are no source
+ * pixels at all, the output image is filled with 0xffff.
+ *
+ */
+void DistanceChamfer34 (Image16_t      *outImg,
+                        const Image8_t *inImg,
+                        const int       toZero)
+{
+  const size_t width  = inImg->width;
+  const size_t height = inImg->height;
+
+  const uint8_t *ptrIn  = inImg->data;
+  uint16_t      *ptrOut = outImg->data;
+
+  const uint16_t *ptrUp;
+
+  uint32_t dist;
+
+  size_t x;
+
+  /* forward pass, first row only looks to the left */
+  dist = CHAMFER_INFINITY;
+
+  for (x = 0; x < width; ++x)
+  {
+    if ( (*ptrIn++ != 0) != (toZero != 0) )
+    {
+      dist = 0;
+    }
+    else
+    {
+      dist = MINVALUE(dist + 3, CHAMFER_INFINITY);
+    }
+
+    *ptrOut++ = dist;
+  }
+
+  /* forward pass, subsequent rows look left and up */
+  NORMAL_LOOP( height - 1,
+
+      ptrUp = ptrOut - width;
+
+      for (x = 0; x < width; ++x)
+      {
+        if ( (*ptrIn++ != 0) != (toZero != 0) )
+        {
+          *ptrOut++ = 0;
+          ptrUp++;
+          continue;
+        }
+
+        dist = *ptrUp + 3;
+
+        if (x > 0)
+        {
+          dist = MINVALUE(dist, *(ptrOut - 1) + 3u);
+          dist = MINVALUE(dist, *(ptrUp - 1) + 4u);
+        }
+
+        if (x < width - 1)
+        {
+          dist = MINVALUE(dist, *(ptrUp + 1) + 4u);
+        }
+
+        *ptrOut++ = MINVALUE(dist, CHAMFER_INFINITY);
+        ptrUp++;
+      }
+  )
+
+  /* backward pass, last row only looks to the right */
+  ptrOut = outImg->data + width * height - 1;
+
+  for (x = 1; x < width; ++x)
+  {
+    dist = *(ptrOut--) + 3u;
+    if (dist < *ptrOut)
+    {
+      *ptrOut = dist;
+    }
+  }
+  ptrOut--;
+
+  const uint16_t *ptrDown;
+
+  /* backward pass, preceding rows look right and down */
+  NORMAL_LOOP( height - 1,
+
+      ptrDown = ptrOut + width;
+
+      for (x = width; x > 0; --x)
+      {
+        dist = *ptrDown + 3u;
+
+        if (x < width)
+        {
+          dist = MINVALUE(dist, *(ptrOut + 1) + 3u);
+          dist = MINVALUE(dist, *(ptrDown + 1) + 4u);
+        }
+
+        if (x > 1)
+        {
+          dist = MINVALUE(dist, *(ptrDown - 1) + 4u);
+        }
+
+        if (dist < *ptrOut)
+        {
+          *ptrOut = dist;
+        }
+
+        ptrOut--;
+        ptrDown--;
+      }
+  )
+}
+
+
+/*
+ * One dimensional squared Euclidean distance transform
+ *
+ * This is the lower envelope of parabolas rooted at every sample from:
+ *
+ * Distance Transforms of Sampled Functions
+ * by Pedro F. Felzenszwalb and Daniel P. Huttenlocher
+ * Cornell Computing and Information Science TR2004-1963
+ *
+ * The arithmetic is all integer. Intersections between parabolas are rounded
+ * down which is exact for the integer sample positions.
+ *
+ */
+static void DistanceSquared1D (uint32_t       *outDist,
+                               const uint32_t *inFunc,
+                               const size_t    length,
+                               const uint32_t  infinity,
+                               size_t         *tmpVertex,   /* length */
+                               int32_t        *tmpBound)    /* length + 1 */
+{
+  size_t  k = 0;
+  size_t  q, vk;
+  int32_t s;
+
+  tmpVertex[0] = 0;
+  tmpBound[0]  = INT32_MIN;
+  tmpBound[1]  = INT32_MAX;
+
+  /* lower envelope */
+  for (q = 1; q < length; ++q)
+  {
+    while (1)
+    {
+      vk = tmpVertex[k];
+
+      s  = ( ((int32_t)inFunc[q] + (int32_t)(q * q))
+             - ((int32_t)inFunc[vk] + (int32_t)(vk * vk)) );
+
+      /* floor division, the denominator is always positive */
+      s  = (s >= 0)
+               ? s / (int32_t)((q - vk) << 1)
+               : -((-s + (int32_t)((q - vk) << 1) - 1)
+                       / (int32_t)((q - vk) << 1));
+
+      /* the first parabola is never removed, its bound is minus infinity */
+      if ( (s <= tmpBound[k]) && k )
+      {
+        --k;
+      }
+      else
+      {
+        break;
+      }
+    }
+
+    ++k;
+    tmpVertex[k]    = q;
+    tmpBound[k]     = s;
+    tmpBound[k + 1] = INT32_MAX;
+  }
+
+  /* fill in the distances from the envelope */
+  uint32_t dist;
+  int32_t  diff;
+
+  k = 0;
+  for (q = 0; q < length; ++q)
+  {
+    while (tmpBound[k + 1] < (int32_t)q)
+    {
+      ++k;
+    }
+
+    diff = (int32_t)q - (int32_t)tmpVertex[k];
+    dist = diff * diff + inFunc[ tmpVertex[k] ];
+
+    *outDist++ = MINVALUE(dist, infinity);
+  }
+}
+
+
+/*
+ * Exact squared Euclidean distance transform of a binary image
+ *
+ * The source pixels are the nonzero pixels in the input image. If toZero is
+ * set, then the source pixels are the zero pixels instead. Every output pixel
+ * is the squared Euclidean distance to the nearest source pixel.
+ *
+ * The two dimensional transform is separable. The one dimensional transform
+ * is applied down the columns and then across the rows. Each is linear in the
+ * number of samples so the whole transform is linear in the image size.
+ *
+ * Pixels beyond the image border are not considered. If there are no source
+ * pixels at all, the output image is filled with width^2 + height^2 which is
+ * larger than any distance inside the image.
+ *
+ */
+void DistanceEuclidean (Image32_t      *outImg,
+                        const Image8_t *inImg,
+                        const int       toZero)
+{
+  const size_t width    = inImg->width;
+  const size_t height   = inImg->height;
+  const size_t length   = (width > height) ? width : height;
+
+  const uint32_t infinity = width * width + height * height;
+
+  uint32_t func[length];
+  uint32_t dist[length];
+  size_t   vertex[length];
+  int32_t  bound[length + 1];
+
+  const uint8_t *ptrIn;
+  uint32_t      *ptrOut;
+  uint32_t      *ptrTmp;
+
+  size_t col;
+
+  /* columns */
+  for (col = 0; col < width; ++col)
+  {
+    ptrIn  = inImg->data + col;
+    ptrTmp = func;
+
+    UNROLL_LOOP( height,
+
+        *ptrTmp++ = ( (*ptrIn != 0) != (toZero != 0) ) ? 0 : infinity;
+        ptrIn += width;
+    )
+
+    DistanceSquared1D(dist, func, height, infinity, vertex, bound);
+
+    ptrOut = outImg->data + col;
+    ptrTmp = dist;
+
+    UNROLL_LOOP( height,
+
+        *ptrOut = *ptrTmp++;
+        ptrOut += width;
+    )
+  }
+
+  /* rows */
+  ptrOut = outImg->data;
+
+  NORMAL_LOOP( height,
+
+      memcpy(func, ptrOut, sizeof(uint32_t) * width);
+
+      DistanceSquared1D(ptrOut, func, width, infinity, vertex, bound);
+
+      ptrOut += width;
+  )
+}
+
+
+/*
+ * Morphological erosion with a disk structuring element of any radius
+ *
+ * Every nonzero pixel within the radius of a zero pixel is set to the mark
+ * value. This is one Euclidean distance transform followed by a threshold so
+ * the cost does not depend on the radius. The temporary image must have the
+ * same dimensions as the input image.
+ *
+ */
+void RegionErodeDisk (Image8_t     *inoutImg,
+                      Image32_t    *tmpImg,
+                      const size_t  radius,
+                      const uint8_t mark)
+{
+  const uint32_t radiusSq = radius * radius;
+
+  uint8_t        *ptrImg  = inoutImg->data;
+  const uint32_t *ptrDist = tmpImg->data;
+
+  uint32_t dist;
+
+  DistanceEuclidean(tmpImg, inoutImg, 1);
+
+  UNROLL_LOOP( inoutImg->width * inoutImg->height,
+
+      dist = *ptrDist++;
+
+      if (dist && (dist <= radiusSq))
+      {
+        *ptrImg = mark;
+      }
+
+      ptrImg++;
+  )
+}
+
+
+/*
+ * Morphological dilation with a disk structuring element of any radius
+ *
+ * Every zero pixel within the radius of a nonzero pixel is set to the mark
+ * value. The temporary image must have the same dimensions as the input image.
+ *
+ */
+void RegionDilateDisk (Image8_t     *inoutImg,
+                       Image32_t    *tmpImg,
+                       const size_t  radius,
+                       const uint8_t mark)
+{
+  const uint32_t radiusSq = radius * radius;
+
+  uint8_t        *ptrImg  = inoutImg->data;
+  const uint32_t *ptrDist = tmpImg->data;
+
+  uint32_t dist;
+
+  DistanceEuclidean(tmpImg, inoutImg, 0);
+
+  UNROLL_LOOP( inoutImg->width * inoutImg->height,
+
+      dist = *ptrDist++;
+
+      if (dist && (dist <= radiusSq))
+      {
+        *ptrImg = mark;
+      }
+
+      ptrImg++;
+  )
+}
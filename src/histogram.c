@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 
 #include "embedcv.h"
@@ -222,6 +223,130 @@ void ImageHistogramCbCrDist (Histogram_t     *outHistogram,
 }
 
 
+/*
+ * Update the histogram of an image after some of its pixels change
+ *
+ * This is for video of a mostly static scene. Instead of counting every
+ * pixel of every frame with ImageHistogram(), the histogram of the previous
+ * frame is updated with only the pixels that differ in the current frame.
+ *
+ * The change map says where to look. Each map pixel covers a square block of
+ * 2^blockShift pixels on a side and is nonzero if the block may have changed.
+ * With a block shift of 0 the map is a per pixel change mask. A block
+ * difference map from thresholding the sum of absolute differences of 16x16
+ * blocks uses a block shift of 4. If the change map is null then every pixel
+ * is compared.
+ *
+ * The cumulative and partial expectation distributions are recomputed only
+ * if some bin changed, and then only from the lowest changed bin upwards as
+ * the bins below it are unaffected. So the cost is proportional to the area
+ * of the changed blocks.
+ *
+ * The previous image must be the image the histogram currently reflects,
+ * which is not always the previous frame. Pixels outside the flagged blocks
+ * are never counted, so with a thresholded block map small changes there are
+ * missed. Passing the real previous frame next time would then subtract
+ * values that were never added and the histogram drifts for good. Instead,
+ * keep a reference image and copy the current image into it over only the
+ * flagged blocks after every update. Pass that reference as the previous
+ * image. A per pixel change mask or a null change map has no such problem.
+ * The number of pixels that changed value is returned.
+ *
+ */
+size_t ImageHistogramUpdate (Histogram_t    *inoutHistogram,
+                             const Image8_t *inPrevImg,
+                             const Image8_t *inCurrImg,
+                             const Image8_t *inChangeMap,  /* may be null */
+                             const size_t    blockShift)
+{
+  const size_t width   = inCurrImg->width;
+  const size_t height  = inCurrImg->height;
+  const size_t numBins = inoutHistogram->numberBins;
+
+  /* a null change map is one block covering the whole image */
+  const size_t mapWidth    = inChangeMap ? inChangeMap->width : 1;
+  const size_t mapHeight   = inChangeMap ? inChangeMap->height : 1;
+  const size_t blockWidth  = inChangeMap ? (size_t)1 << blockShift : width;
+  const size_t blockHeight = inChangeMap ? (size_t)1 << blockShift : height;
+
+  size_t *ptrBins = inoutHistogram->bins;
+
+  const uint8_t *ptrPrev, *ptrCurr;
+
+  size_t mapRow, mapCol, row, col, rowBegin, rowEnd, colEnd;
+  size_t minBin  = numBins;
+  size_t changed = 0;
+
+  for (mapRow = 0; mapRow < mapHeight; ++mapRow)
+  {
+    rowBegin = mapRow * blockHeight;
+    rowEnd   = (rowBegin + blockHeight < height)
+                   ? rowBegin + blockHeight : height;
+
+    for (mapCol = 0; mapCol < mapWidth; ++mapCol)
+    {
+      if (inChangeMap && (! inChangeMap->data[mapRow * mapWidth + mapCol]))
+      {
+        continue;
+      }
+
+      col    = mapCol * blockWidth;
+      colEnd = (col + blockWidth < width) ? col + blockWidth : width;
+
+      for (row = rowBegin; row < rowEnd; ++row)
+      {
+        ptrPrev = inPrevImg->data + row * width + col;
+        ptrCurr = inCurrImg->data + row * width + col;
+
+        NORMAL_LOOP( colEnd - col,
+
+            if (*ptrPrev != *ptrCurr)
+            {
+              ptrBins[ *ptrPrev ]--;
+              ptrBins[ *ptrCurr ]++;
+
+              if (*ptrPrev < minBin)
+              {
+                minBin = *ptrPrev;
+              }
+
+              if (*ptrCurr < minBin)
+              {
+                minBin = *ptrCurr;
+              }
+
+              changed++;
+            }
+
+            ptrPrev++;
+            ptrCurr++;
+        )
+      }
+    }
+  }
+
+  /* cumulative and partial expectation distributions above lowest change */
+  if (changed)
+  {
+    size_t *ptrSumBins  = inoutHistogram->sumBins + minBin;
+    size_t *ptrMeanBins = inoutHistogram->meanBins + minBin;
+    size_t accumSum     = minBin ? *(ptrSumBins - 1) : 0;
+    size_t accumMean    = minBin ? *(ptrMeanBins - 1) : 0;
+
+    size_t tmp, i;
+    ptrBins += minBin;
+    for (i = minBin; i < numBins; ++i)
+    {
+      tmp       = *ptrBins++;
+      accumSum  = *ptrSumBins++  = accumSum + tmp;
+      accumMean = *ptrMeanBins++ = accumMean + i * tmp;
+    }
+  }
+
+  return changed;
+}
+
+
 /*
  * Compute basic statistics of a histogram
  *
@@ -369,42 +494,179 @@ void EqualizeImage (Image8_t          *outImg,
  * by Maria Petrou and Panagiota Bosdogianni
  * Wiley, 1999
  *
+ * The threshold t splits the histogram into the bins below t and the bins
+ * from t on. It maximizes the interclass variance which is proportional to:
+ *
+ *   (meanBins[t-1] - mean * sumBins[t-1])^2
+ *       / (sumBins[t-1] * (numCounts - sumBins[t-1]))
+ *
+ * Every bin is tried as the cumulative arrays make each one constant time.
+ * The interclass variance may have more than one local maximum so stopping
+ * at the first decrease is not enough. The first of equal maxima is chosen.
+ * The arithmetic is 64 bit so large images do not overflow.
+ *
  */
 size_t OtsuThreshold (const Histogram_t *inHistogram)
 {
-  const size_t numBins      = inHistogram->numberBins;
-  const size_t numCounts    = inHistogram->numberCounts;
-
-  const size_t *ptrMeanBins = inHistogram->meanBins;
-  const size_t mean         = ptrMeanBins[numBins - 1] / numCounts;
+  const size_t numBins   = inHistogram->numberBins;
+  const size_t numCounts = inHistogram->numberCounts;
+  const size_t totalMean = inHistogram->meanBins[numBins - 1];
 
   const size_t *ptrSumBins  = inHistogram->sumBins;
-  const size_t *headSumBins = ptrSumBins;
-  const size_t *endSumBins  = ptrSumBins + numBins;
+  const size_t *ptrMeanBins = inHistogram->meanBins;
 
-  size_t last = 0, curr, a, p;
+  uint64_t best = 0, curr, a, p;
+  size_t   bestIdx = 0, i;
 
   /* find threshold that maximizes interclass variance */
-  while (ptrSumBins != endSumBins)
+  for (i = 0; i < numBins; ++i)
   {
-    p    = *ptrSumBins++;
+    p = *ptrSumBins++;
+    a = *ptrMeanBins++;
 
     if ( (p == 0) || (p == numCounts) )
     {
       continue;  /* avoid divide by zero */
     }
 
-    a    = UINTDIFF( *ptrMeanBins++, mean * p );
-
+    a    = UINTDIFF( a, (p * totalMean) / numCounts );
     curr = (a * a) / (p * (numCounts - p));
-    if (curr < last)
+
+    if (curr > best)
     {
-      break;
+      best    = curr;
+      bestIdx = i;
+    }
+  }
+
+  return bestIdx + 1;
+}
+
+
+/*
+ * Squared class sum over the class count, (sum * sum) / count rounded down
+ *
+ * With sum = q * count + r this is q * q * count + 2 * q * r + r * r / count.
+ * The mean q is at most the number of bins and r is less than the count so
+ * no term overflows 64 bits even when sum * sum would.
+ *
+ */
+static uint64_t OtsuClassScore (const uint64_t sum,
+                                const uint64_t count)
+{
+  uint64_t q, r;
+
+  if (! count)
+  {
+    return 0;
+  }
+
+  q = sum / count;
+  r = sum % count;
+
+  return q * sum + q * r + (r * r) / count;
+}
+
+
+/*
+ * Compute several Otsu thresholds for multi-level segmentation
+ *
+ * The thresholds split the histogram into numThresholds + 1 classes. Class
+ * zero is the bins below outThresholds[0], class one is the bins from
+ * outThresholds[0] up to outThresholds[1] and so on. The thresholds maximize
+ * the interclass variance which is the same as maximizing the sum over the
+ * classes of (class sum)^2 / (class count). This comes from the cumulative
+ * sumBins and meanBins arrays in constant time for any interval of bins.
+ *
+ * An exhaustive search over all combinations of thresholds is too slow for
+ * more than two thresholds. Instead, the best split of the first k bins into
+ * m classes is built from the best splits into m - 1 classes. This is exact
+ * and costs numThresholds * numBins^2 / 2 interval lookups. So it suits
+ * histograms of a few hundred bins and 2 to 4 thresholds.
+ *
+ * The temporary arrays are supplied by the caller as they grow with the
+ * number of bins. The score array needs 2 * numBins elements and the split
+ * array needs numThresholds * numBins elements. At most 65536 bins are
+ * supported. Every class needs at least one bin so only numBins - 1
+ * thresholds are found. Any more thresholds are set to numBins.
+ *
+ */
+void OtsuMultiThreshold (size_t            *outThresholds,
+                         uint64_t          *tmpScore,
+                         uint16_t          *tmpSplit,
+                         const size_t       numThresholds,
+                         const Histogram_t *inHistogram)
+{
+  const size_t  numBins     = inHistogram->numberBins;
+  const size_t *ptrSumBins  = inHistogram->sumBins;
+  const size_t *ptrMeanBins = inHistogram->meanBins;
+
+  /* thresholds that leave at least one bin for every class */
+  const size_t numSplits = (numThresholds < numBins) ? numThresholds
+                                                     : (numBins ? numBins - 1
+                                                                : 0);
+
+  /* best scores for the previous and current number of classes */
+  uint64_t *prevScore = tmpScore;
+  uint64_t *currScore = tmpScore + numBins;
+  uint64_t *swapTmp;
+
+  /* last bin of the previous class for m + 1 classes in row m - 1 */
+  uint16_t *split;
+
+  uint64_t curr;
+  size_t   m, k, j;
+
+  for (m = numSplits; m < numThresholds; ++m)
+  {
+    outThresholds[m] = numBins;
+  }
+
+  if (! numSplits)
+  {
+    return;
+  }
+
+  /* one class of the first k + 1 bins */
+  for (k = 0; k < numBins; ++k)
+  {
+    prevScore[k] = OtsuClassScore(ptrMeanBins[k], ptrSumBins[k]);
+  }
+
+  /* the last class is bins j + 1 to k */
+  for (m = 1; m <= numSplits; ++m)
+  {
+    split = tmpSplit + (m - 1) * numBins;
+
+    for (k = m; k < numBins; ++k)
+    {
+      currScore[k] = 0;
+      split[k]     = m - 1;
+
+      for (j = m - 1; j < k; ++j)
+      {
+        curr = prevScore[j]
+               + OtsuClassScore(ptrMeanBins[k] - ptrMeanBins[j],
+                                ptrSumBins[k] - ptrSumBins[j]);
+
+        if (curr > currScore[k])
+        {
+          currScore[k] = curr;
+          split[k]     = j;
+        }
+      }
     }
-    last = curr;
+
+    swapTmp = prevScore; prevScore = currScore; currScore = swapTmp;
   }
 
-  return ptrSumBins - headSumBins;
+  /* trace back the class boundaries */
+  k = numBins - 1;
+  for (m = numSplits; m > 0; --m)
+  {
+    k = tmpSplit[(m - 1) * numBins + k];
+    outThresholds[m - 1] = k + 1;
+  }
 }
 
 
@@ -432,43 +694,224 @@ void SegmentMap (uint8_t       *outMap,
 }
 
 
+/*
+ * Rasterize an ellipse of values into a packed CbCr segmentation map
+ *
+ * The ellipse is aligned with the Cb and Cr axes. It is rasterized one Cr
+ * row at a time. The Cb span of a row comes from the ellipse equation with an
+ * integer square root and is filled at once. So the cost is proportional to
+ * the number of values in the ellipse instead of testing all 65536 values.
+ * A zero radius allows only the center value along that axis.
+ *
+ * If openUpper is set, then the ellipse is also clipped to the half open box
+ * from center - radius up to but excluding center + radius on both axes.
+ *
+ */
+static void SegmentMapCbCrSpans (uint8_t        *outMap,
+                                 const uint16_t  center,
+                                 const size_t    radiusCb,
+                                 const size_t    radiusCr,
+                                 const int       openUpper,
+                                 const uint8_t   value)
+{
+  const int centerCb = ((PackedCbCr_t)center).data[0];
+  const int centerCr = ((PackedCbCr_t)center).data[1];
+  const int upper    = openUpper ? 1 : 0;
+
+  const uint64_t radiusCbSq = (uint64_t)radiusCb * radiusCb;
+  const uint64_t radiusCrSq = (uint64_t)radiusCr * radiusCr;
+
+  PackedCbCr_t index;
+
+  int      beginCr, endCr, beginCb, endCb, limitCb, cr, cb;
+  size_t   diffCr, half;
+
+  /* Cb is the low byte on little endian hosts so Cb spans are contiguous */
+  index.data[0] = 1;
+  index.data[1] = 0;
+  const int contiguous = (1 == index.CbCr);
+
+  beginCr = (radiusCr > (size_t)centerCr) ? 0 : centerCr - (int)radiusCr;
+  endCr   = (radiusCr + centerCr > 255) ? 255
+                                        : centerCr + (int)radiusCr - upper;
+  limitCb = (radiusCb + centerCb > 255) ? 255
+                                        : centerCb + (int)radiusCb - upper;
+
+  for (cr = beginCr; cr <= endCr; ++cr)
+  {
+    diffCr = UINTDIFF(cr, centerCr);
+
+    /* largest Cb difference inside the ellipse for this Cr */
+    half = radiusCr
+               ? UintSqrt64(radiusCbSq
+                            * (radiusCrSq - (uint64_t)diffCr * diffCr)
+                            / radiusCrSq)
+               : radiusCb;
+
+    beginCb = (half > (size_t)centerCb) ? 0 : centerCb - (int)half;
+    endCb   = (half + centerCb > (size_t)limitCb) ? limitCb
+                                                  : centerCb + (int)half;
+
+    if (endCb < beginCb)
+    {
+      continue;
+    }
+
+    index.data[0] = beginCb;
+    index.data[1] = cr;
+
+    if (contiguous)
+    {
+      memset(outMap + index.CbCr, value, endCb - beginCb + 1);
+    }
+    else
+    {
+      for (cb = beginCb; cb <= endCb; ++cb)
+      {
+        index.data[0] = cb;
+        outMap[index.CbCr] = value;
+      }
+    }
+  }
+}
+
+
 /*
  * Add a circle of pixel values to a 16 bit packed CbCr image segmentation map
  *
+ * The circle is every CbCr value within the threshold distance of the center,
+ * so the squared distance is no more than the threshold squared. It is also
+ * limited to the bounding box from center - threshold up to but excluding
+ * center + threshold on both axes, as with SegmentMap(). So the values at
+ * center + threshold are never set and a zero threshold adds nothing.
+ *
  */
 void SegmentMapCbCr (uint8_t        *outMap,
                      const uint16_t  center,
                      const size_t    threshold,
                      const uint8_t   value)
 {
-  /* generate Cb and Cr segmentation maps for bounding box */
-  uint8_t cbMap[256], crMap[256];
-  const uint8_t centerCb = ((PackedCbCr_t)center).data[0];
-  const uint8_t centerCr = ((PackedCbCr_t)center).data[1];
-  SegmentMap(cbMap, centerCb, threshold, 1);
-  SegmentMap(crMap, centerCr, threshold, 1);
-
-  /* initial point of 0 */
-  const size_t  thresholdSq = threshold * threshold;
-  if (*cbMap && *crMap && (CbCrSSD(center, 0) <= thresholdSq))
+  SegmentMapCbCrSpans(outMap, center, threshold, threshold, 1, value);
+}
+
+
+/*
+ * Add an ellipse of pixel values to a 16 bit packed CbCr segmentation map
+ *
+ * The ellipse is aligned with the Cb and Cr axes and is closed, so it has
+ * every value on or inside its boundary. A zero radius allows only the
+ * center value along that axis.
+ *
+ */
+void SegmentMapCbCrEllipse (uint8_t        *outMap,
+                            const uint16_t  center,
+                            const size_t    radiusCb,
+                            const size_t    radiusCr,
+                            const uint8_t   value)
+{
+  SegmentMapCbCrSpans(outMap, center, radiusCb, radiusCr, 0, value);
+}
+
+
+/*
+ * Add several classes of pixel values to a packed CbCr segmentation map
+ *
+ * Every class is an ellipse with its own map value. The classes are added in
+ * order so later classes overwrite earlier ones where they overlap.
+ *
+ */
+void SegmentMapCbCrClasses (uint8_t              *outMap,
+                            const SegmentClass_t *inClasses,
+                            const size_t          numClasses)
+{
+  size_t i;
+
+  for (i = 0; i < numClasses; ++i)
   {
-    *outMap = value;
+    SegmentMapCbCrEllipse(outMap, inClasses[i].center,
+                          inClasses[i].radiusCb, inClasses[i].radiusCr,
+                          inClasses[i].value);
   }
+}
+
+
+/*
+ * Compress a 65536 entry segmentation map to one bit per entry
+ *
+ * Every nonzero map entry becomes a set bit. Entry i is bit (i & 7) of byte
+ * i >> 3. The bitset is 8 KiB instead of 64 KiB so it stays in a small data
+ * cache during segmentation. This only suits maps of a single class.
+ *
+ */
+void SegmentMapToBits (uint8_t       *outBits,  /* length is 8192 */
+                       const uint8_t *inMap)    /* length is 65536 */
+{
+  uint8_t bits;
+
+  NORMAL_LOOP( 8192,
+
+      bits = 0;
+
+      bits |= (inMap[0] != 0);
+      bits |= (inMap[1] != 0) << 1;
+      bits |= (inMap[2] != 0) << 2;
+      bits |= (inMap[3] != 0) << 3;
+      bits |= (inMap[4] != 0) << 4;
+      bits |= (inMap[5] != 0) << 5;
+      bits |= (inMap[6] != 0) << 6;
+      bits |= (inMap[7] != 0) << 7;
 
-  /* all other points */
-  uint8_t iCb, iCr;
-  uint16_t i;
-  for (i = 1; i != 0; ++i)
+      *outBits++ = bits;
+      inMap += 8;
+  )
+}
+
+
+/*
+ * Compress a 65536 entry segmentation map to a two level table
+ *
+ * The map is split into 256 blocks of 256 entries by the high byte of the
+ * index. Identical blocks are stored once as a leaf and the directory has the
+ * leaf of every block. A CbCr map of a few small classes has mostly empty
+ * blocks which all share one leaf. So the table is a few KiB instead of 64.
+ *
+ * Lookups always go through the directory and one leaf without any branch.
+ * The number of leaves is returned. If the map needs more leaves than the
+ * table has room for then 0 is returned and the table is not usable.
+ *
+ */
+size_t SegmentMapToLUT (SegmentLUT_t  *outLUT,
+                        const uint8_t *inMap)    /* length is 65536 */
+{
+  uint8_t *leaves    = outLUT->leaves;
+  size_t   numLeaves = 0;
+  size_t   block, leaf;
+
+  for (block = 0; block < 256; ++block)
   {
-    iCb = ((PackedCbCr_t)i).data[0];
-    iCr = ((PackedCbCr_t)i).data[1];
+    for (leaf = 0; leaf < numLeaves; ++leaf)
+    {
+      if (! memcmp(leaves + (leaf << 8), inMap, 256))
+      {
+        break;
+      }
+    }
 
-    /* check if point is inside bounding box around threshold circle */
-    if (cbMap[iCb] && crMap[iCr] && (CbCrSSD(center, i) <= thresholdSq))
+    if (leaf == numLeaves)
     {
-      outMap[i] = value;
+      if (numLeaves == outLUT->maxLeaves)
+      {
+        return outLUT->numberLeaves = 0;
+      }
+
+      memcpy(leaves + (numLeaves++ << 8), inMap, 256);
     }
+
+    outLUT->directory[block] = leaf;
+    inMap += 256;
   }
+
+  return outLUT->numberLeaves = numLeaves;
 }
 
 
@@ -513,6 +956,115 @@ void SegmentImageW (Image8_t        *outImg,
 }
 
 
+/*
+ * Compute image segmentation of a packed 16 bit image in changed blocks only
+ *
+ * This is the same as SegmentImageW() for the pixels in the changed blocks
+ * of a change map. Pixels in other blocks are left alone.
+ *
+ */
+void SegmentImageWMasked (Image8_t        *outImg,
+                          const Image16_t *inImg,
+                          const uint8_t   *inMap,
+                          const Image8_t  *inChangeMap)
+{
+  const size_t width  = outImg->width;
+  const size_t height = outImg->height;
+
+  const uint8_t *ptrMap = inChangeMap->data;
+
+  const uint16_t *ptrInImg;
+  uint8_t        *ptrOutImg;
+
+  size_t mapRow, mapCol, row, col, rowEnd, colEnd;
+
+  for (mapRow = 0; mapRow < inChangeMap->height; ++mapRow)
+  {
+    rowEnd = (mapRow + 1) * CHANGEMAP_BLOCK;
+
+    if (rowEnd > height)
+    {
+      rowEnd = height;
+    }
+
+    for (mapCol = 0; mapCol < inChangeMap->width; ++mapCol)
+    {
+      if (! *ptrMap++)
+      {
+        continue;
+      }
+
+      col    = mapCol * CHANGEMAP_BLOCK;
+      colEnd = (col + CHANGEMAP_BLOCK < width) ? col + CHANGEMAP_BLOCK : width;
+
+      for (row = mapRow * CHANGEMAP_BLOCK; row < rowEnd; ++row)
+      {
+        ptrInImg  = inImg->data + row * width + col;
+        ptrOutImg = outImg->data + row * width + col;
+
+        UNROLL_LOOP( colEnd - col,
+
+            *ptrOutImg++ = inMap[ *ptrInImg++ ];
+        )
+      }
+    }
+  }
+}
+
+
+/*
+ * Compute image segmentation of a packed 16 bit image with a bitset map
+ *
+ * Pixels with a set bit in the map from SegmentMapToBits() become the value
+ * and all others become zero.
+ *
+ */
+void SegmentImageWBits (Image8_t        *outImg,
+                        const Image16_t *inImg,
+                        const uint8_t   *inBits,
+                        const uint8_t    value)
+{
+  const size_t    numPixels = outImg->width * outImg->height;
+  uint8_t        *ptrOutImg = outImg->data;
+  const uint16_t *ptrInImg  = inImg->data;
+
+  uint16_t pixel;
+
+  UNROLL_LOOP( numPixels,
+
+      pixel = *ptrInImg++;
+      *ptrOutImg++ = -((inBits[ pixel >> 3 ] >> (pixel & 7)) & 1) & value;
+  )
+}
+
+
+/*
+ * Compute image segmentation of a packed 16 bit image with a two level map
+ *
+ * This gives the same result as SegmentImageW() with the map that was
+ * compressed by SegmentMapToLUT().
+ *
+ */
+void SegmentImageWLUT (Image8_t           *outImg,
+                       const Image16_t    *inImg,
+                       const SegmentLUT_t *inLUT)
+{
+  const size_t    numPixels = outImg->width * outImg->height;
+  const uint8_t  *directory = inLUT->directory;
+  const uint8_t  *leaves    = inLUT->leaves;
+  uint8_t        *ptrOutImg = outImg->data;
+  const uint16_t *ptrInImg  = inImg->data;
+
+  uint16_t pixel;
+
+  UNROLL_LOOP( numPixels,
+
+      pixel = *ptrInImg++;
+      *ptrOutImg++ = leaves[ (directory[ pixel >> 8 ] << 8) | (pixel & 0xff) ];
+  )
+}
+
+
 /*
  * Split individual image segments out from a single image after segmentation
  *
@@ -55,6 +55,60 @@ int16_t HoughRadius(const int16_t x,
 }
 
 
+/*
+ * Calculate radius distances of Hough lines for consecutive orientations
+ *
+ * The output is the same as HoughRadius() for orientations theta, theta + 1,
+ * up to theta + count - 1 (wrapping around at 128) except for rounding.
+ *
+ * The radius is a sinusoid in the orientation. So stepping the orientation
+ * by a constant angle obeys the recurrence:
+ *
+ *   r(theta + 1) = 2*cos(step)*r(theta) - r(theta - 1)
+ *
+ * The first two values come from the trigonometric tables. Every one after
+ * that costs one multiply and one subtract. The radius is kept with 16
+ * fractional bits and the coefficient with 30 fractional bits so rounding
+ * error does not build up over a full turn.
+ *
+ */
+void HoughRadiusWalk(int16_t      *outRadius,
+                     const int16_t x,
+                     const int16_t y,
+                     const size_t  theta,
+                     const size_t  count)
+{
+  /* 2*cos(2*pi/128) with 30 fractional bits */
+  const int64_t twoCosStep = 2144896910;
+
+  int32_t r0, r1, r2;
+
+  if (! count)
+  {
+    return;
+  }
+
+  r0 = x * UintCos(theta) + y * UintSin(theta);
+  *outRadius++ = r0 >> 16;
+
+  if (count == 1)
+  {
+    return;
+  }
+
+  r1 = x * UintCos(theta + 1) + y * UintSin(theta + 1);
+  *outRadius++ = r1 >> 16;
+
+  NORMAL_LOOP( count - 2,
+
+      r2 = ((twoCosStep * r1 + (1 << 29)) >> 30) - r0;
+      *outRadius++ = r2 >> 16;
+      r0 = r1;
+      r1 = r2;
+  )
+}
+
+
 /*
  * Add the line votes from an image point to the Hough image
  *
@@ -70,15 +124,20 @@ void HoughVoteLine(Image32_t    *img,
                    const size_t  neighborhood)
 {
   const size_t  radiusLimit = img->height;
-  size_t       *ptr         = img->data;
+  const size_t  numVotes    = (neighborhood << 2) + 1;
+  uint32_t     *ptr         = img->data;
+  int16_t       radius[numVotes];
+  int16_t      *ptrRadius   = radius;
   int16_t       r;
 
   /* use gradient optimization to estimate lines to vote for */
   size_t theta = (ApproxAtan2(dy, dx) - neighborhood) % 128;
 
-  UNROLL_LOOP( (neighborhood << 2) + 1,
+  HoughRadiusWalk(radius, x, y, theta, numVotes);
 
-      if ((r = HoughRadius(x, y, theta)) > 0)
+  UNROLL_LOOP( numVotes,
+
+      if ((r = *ptrRadius++) > 0)
       {
         r >>= 2;  /* Hough counting bins are 4 radius units high */
       }
@@ -94,3 +153,203 @@ void HoughVoteLine(Image32_t    *img,
   )
 }
 
+
+/*
+ * Index of a Hough transform bin with orientation wrapped around
+ *
+ * Orientation is periodic so theta 127 is next to theta 0. A line with a
+ * negative radius is the same as the line with the opposite orientation and
+ * positive radius. So radius bin -1 is radius bin 0 at theta + 64. Bins past
+ * the bottom of the accumulator image do not exist and the index is -1.
+ *
+ */
+static int32_t HoughIndex (const Image32_t *inImg,
+                           const int32_t    theta,
+                           const int32_t    radius)
+{
+  if (radius < 0)
+  {
+    return HoughIndex(inImg, theta + 64, -radius - 1);
+  }
+
+  if (radius >= (int32_t)inImg->height)
+  {
+    return -1;
+  }
+
+  return (radius << 7) + (theta & 127);
+}
+
+
+/*
+ * Value of a Hough transform bin with orientation wrapped around
+ *
+ */
+static uint32_t HoughBin (const Image32_t *inImg,
+                          const int32_t    theta,
+                          const int32_t    radius)
+{
+  const int32_t idx = HoughIndex(inImg, theta, radius);
+
+  return (idx < 0) ? 0 : inImg->data[idx];
+}
+
+
+/*
+ * Sub-bin offset of a peak from a parabola through three neighboring bins
+ *
+ * The offset is in 1/256 bin units and ranges from -128 to 128.
+ *
+ */
+static int32_t HoughRefine (const uint32_t before,
+                            const uint32_t center,
+                            const uint32_t after)
+{
+  const int32_t curvature = (int32_t)before + (int32_t)after
+                                - ((int32_t)center << 1);
+
+  if (curvature >= 0)
+  {
+    return 0;  /* flat or not a maximum */
+  }
+
+  return ( ((int32_t)before - (int32_t)after) << 7 ) / curvature;
+}
+
+
+/*
+ * Find the strongest peaks in a Hough transform accumulator image
+ *
+ * A bin is a peak if it has more votes than the threshold and no other bin
+ * in the window around it has more votes. The window is thetaWindow bins to
+ * either side in orientation and radiusWindow bins up and down in radius.
+ * Orientation wraps around at 128. Above radius bin 0, the window continues
+ * on the other side of the origin at the opposite orientation. When bins tie,
+ * the first one in memory order wins.
+ *
+ * The accumulator is scanned four bins at a time against the threshold.
+ * Only the few bins over the threshold need the window test.
+ *
+ * The peaks are returned sorted by decreasing votes. At most maxPeaks are
+ * returned. The refined position of each peak comes from fitting parabolas
+ * through the neighboring bins. The fine theta and radius are in 1/256 bin
+ * units.
+ *
+ */
+size_t HoughPeaks (HoughPeak_t     *outPeaks,
+                   const size_t     maxPeaks,
+                   const Image32_t *inImg,
+                   const size_t     threshold,
+                   const size_t     thetaWindow,
+                   const size_t     radiusWindow)
+{
+  const int32_t height = inImg->height;
+  const int32_t tWin   = thetaWindow;
+  const int32_t rWin   = radiusWindow;
+
+  const uint32_t *ptrImg = inImg->data;
+
+  size_t   numPeaks = 0;
+  int32_t  theta, radius, dt, dr, offset, idx, otherIdx;
+  uint32_t votes, other;
+  size_t   i;
+  int      isPeak;
+
+  if (! maxPeaks)
+  {
+    return 0;
+  }
+
+  for (radius = 0; radius < height; ++radius)
+  {
+    for (theta = 0; theta < 128; theta += 4, ptrImg += 4)
+    {
+      /* most blocks of four bins are entirely under the threshold */
+      if ( ! ( (ptrImg[0] > threshold) | (ptrImg[1] > threshold)
+               | (ptrImg[2] > threshold) | (ptrImg[3] > threshold) ) )
+      {
+        continue;
+      }
+
+      for (i = 0; i < 4; ++i)
+      {
+        votes = ptrImg[i];
+        idx   = (radius << 7) + theta + i;
+
+        /* not strong enough to make the list */
+        if ( (votes <= threshold)
+             || ( (numPeaks == maxPeaks)
+                  && (votes <= outPeaks[numPeaks - 1].votes) ) )
+        {
+          continue;
+        }
+
+        /* window non-maximum suppression */
+        isPeak = 1;
+
+        for (dr = -rWin; isPeak && (dr <= rWin); ++dr)
+        {
+          for (dt = -tWin; dt <= tWin; ++dt)
+          {
+            otherIdx = HoughIndex(inImg, theta + i + dt, radius + dr);
+
+            if ( (otherIdx < 0) || (otherIdx == idx) )
+            {
+              continue;
+            }
+
+            other = inImg->data[otherIdx];
+
+            /* ties go to the bin earlier in memory */
+            if ( (other > votes) || ((other == votes) && (otherIdx < idx)) )
+            {
+              isPeak = 0;
+              break;
+            }
+          }
+        }
+
+        if (! isPeak)
+        {
+          continue;
+        }
+
+        /* insert into list sorted by decreasing votes */
+        size_t pos = (numPeaks < maxPeaks) ? numPeaks++ : numPeaks - 1;
+
+        while ( pos && (outPeaks[pos - 1].votes < votes) )
+        {
+          outPeaks[pos] = outPeaks[pos - 1];
+          --pos;
+        }
+
+        outPeaks[pos].theta  = theta + i;
+        outPeaks[pos].radius = radius;
+        outPeaks[pos].votes  = votes;
+      }
+    }
+  }
+
+  /* sub-bin refinement */
+  for (i = 0; i < numPeaks; ++i)
+  {
+    theta  = outPeaks[i].theta;
+    radius = outPeaks[i].radius;
+    votes  = outPeaks[i].votes;
+
+    offset = HoughRefine(HoughBin(inImg, theta - 1, radius),
+                         votes,
+                         HoughBin(inImg, theta + 1, radius));
+
+    outPeaks[i].thetaFine = ((theta << 8) + offset) & 0x7fff;
+
+    offset = HoughRefine(HoughBin(inImg, theta, radius - 1),
+                         votes,
+                         HoughBin(inImg, theta, radius + 1));
+
+    outPeaks[i].radiusFine = ((radius << 8) + offset < 0)
+                                 ? 0 : (radius << 8) + offset;
+  }
+
+  return numPeaks;
+}
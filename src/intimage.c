@@ -41,7 +41,7 @@ void IntegralImage (Image32_t      *outImg,
 {
   const size_t width = inImg->width;
 
-  size_t        *ptrOut = outImg->data;
+  uint32_t       *ptrOut = outImg->data;
   const uint8_t  *ptrIn = inImg->data;
 
   size_t accum = 0;
@@ -53,7 +53,7 @@ void IntegralImage (Image32_t      *outImg,
       *ptrOut++ = accum;
   )
 
-  const size_t *ptrLast;
+  const uint32_t *ptrLast;
 
   /* subsequent rows */
   UNROLL_LOOP( inImg->height - 1,
@@ -70,6 +70,225 @@ void IntegralImage (Image32_t      *outImg,
 }
 
 
+/*
+ * Integral image and squared integral image in the same pass
+ *
+ * The squared integral image is the sum of the squares of pixel values. Each
+ * pixel is read once for both. The squared sums need 64 bits for images
+ * larger than about 256 by 256 pixels.
+ *
+ */
+void IntegralImageSq (Image32_t      *outImg,
+                      Image64_t      *outSqImg,
+                      const Image8_t *inImg)
+{
+  const size_t width = inImg->width;
+
+  uint32_t       *ptrOut   = outImg->data;
+  uint64_t       *ptrOutSq = outSqImg->data;
+  const uint8_t  *ptrIn    = inImg->data;
+
+  size_t   accum = 0, pixel;
+  uint64_t accumSq = 0;
+
+  /* first row */
+  UNROLL_LOOP( width,
+
+      pixel = *ptrIn++;
+      accum   += pixel;
+      accumSq += pixel * pixel;
+      *ptrOut++   = accum;
+      *ptrOutSq++ = accumSq;
+  )
+
+  const uint32_t *ptrLast;
+  const uint64_t *ptrLastSq;
+
+  /* subsequent rows */
+  NORMAL_LOOP( inImg->height - 1,
+
+      ptrLast   = ptrOut - width;
+      ptrLastSq = ptrOutSq - width;
+      accum     = 0;
+      accumSq   = 0;
+
+      UNROLL_LOOP( width,
+
+          pixel = *ptrIn++;
+          accum   += pixel;
+          accumSq += pixel * pixel;
+          *ptrOut++   = accum + *ptrLast++;
+          *ptrOutSq++ = accumSq + *ptrLastSq++;
+      )
+  )
+}
+
+
+/*
+ * Mean and variance over a square window around every pixel
+ *
+ * Each window sum is four corners from the integral images so the cost per
+ * pixel is constant no matter how large the window is. The window is clipped
+ * at the image borders and the statistics are over the pixels inside it.
+ * The variance of 8 bit pixels is never more than 16256 so it fits in 16
+ * bits. Either output image is optional.
+ *
+ */
+void LocalMeanVariance (Image8_t        *outMean,
+                        Image16_t       *outVariance,
+                        const Image32_t *inImg,
+                        const Image64_t *inSqImg,
+                        const size_t     window)
+{
+  const size_t width  = inImg->width;
+  const size_t height = inImg->height;
+  const size_t half   = window >> 1;
+
+  uint8_t  *ptrMean     = outMean ? outMean->data : 0;
+  uint16_t *ptrVariance = outVariance ? outVariance->data : 0;
+
+  /* clipped window columns, first column is one past the left corner */
+  size_t colFirst[width], colLast[width];
+
+  const uint32_t *rowTop,   *rowBottom;
+  const uint64_t *rowTopSq, *rowBottomSq;
+
+  size_t   row, col, rowFirst, rowLast, x0, x1, count;
+  uint64_t sum, sumSq;
+
+  for (col = 0; col < width; ++col)
+  {
+    colFirst[col] = (col > half) ? col - half : 0;
+    colLast[col]  = (col + half < width) ? col + half : width - 1;
+  }
+
+  for (row = 0; row < height; ++row)
+  {
+    rowFirst = (row > half) ? row - half : 0;
+    rowLast  = (row + half < height) ? row + half : height - 1;
+
+    /* the row above the window is zero at the top border */
+    rowTop      = rowFirst ? inImg->data + (rowFirst - 1) * width : 0;
+    rowTopSq    = rowFirst ? inSqImg->data + (rowFirst - 1) * width : 0;
+    rowBottom   = inImg->data + rowLast * width;
+    rowBottomSq = inSqImg->data + rowLast * width;
+
+    for (col = 0; col < width; ++col)
+    {
+      x0 = colFirst[col];
+      x1 = colLast[col];
+
+      sum   = rowBottom[x1];
+      sumSq = rowBottomSq[x1];
+
+      if (x0)
+      {
+        sum   -= rowBottom[x0 - 1];
+        sumSq -= rowBottomSq[x0 - 1];
+      }
+
+      if (rowTop)
+      {
+        sum   -= rowTop[x1];
+        sumSq -= rowTopSq[x1];
+
+        if (x0)
+        {
+          sum   += rowTop[x0 - 1];
+          sumSq += rowTopSq[x0 - 1];
+        }
+      }
+
+      count = (rowLast - rowFirst + 1) * (x1 - x0 + 1);
+
+      if (ptrMean)
+      {
+        *ptrMean++ = sum / count;
+      }
+
+      if (ptrVariance)
+      {
+        *ptrVariance++ = (count * sumSq - sum * sum) / (count * count);
+      }
+    }
+  }
+}
+
+
+/*
+ * Rotated integral image (as used by Lienhart and Maydt)
+ *
+ * Every output pixel is the sum of the input pixels inside the triangle
+ * above it bounded by the two diagonals through it:
+ *
+ *   tilted(x, y) = sum of input(x', y') where y' <= y, |x - x'| <= y - y'
+ *
+ * Pixels outside the image count as zero. Any box rotated 45 degrees then
+ * sums from four corners, see IntegralFeatureTiltedUpDown().
+ *
+ * The triangle is the difference of two running sums along the diagonals of
+ * the horizontal row sums. The down-left one is the row sum up to x added to
+ * the same sum one row up and one column right. The down-right one is the
+ * row sum before x added to the same sum one row up and one column left.
+ * Past the right border the down-left sum is just the total of all rows so
+ * far. So the whole image is one pass with two row buffers.
+ *
+ */
+void IntegralImageTilted (Image32_t      *outImg,
+                          const Image8_t *inImg)
+{
+  const size_t width = inImg->width;
+
+  const uint8_t *ptrIn  = inImg->data;
+  uint32_t      *ptrOut = outImg->data;
+
+  /* diagonal sums for the previous and current rows */
+  uint32_t leftA[width], leftB[width], rightA[width], rightB[width];
+
+  uint32_t *prevLeft  = leftA,  *currLeft  = leftB;
+  uint32_t *prevRight = rightA, *currRight = rightB;
+  uint32_t *swapTmp;
+
+  uint32_t rowSum, rowTotal, allTotal = 0, prevTotal;
+  size_t   x;
+
+  memset(prevLeft, 0, sizeof(uint32_t) * width);
+  memset(prevRight, 0, sizeof(uint32_t) * width);
+
+  NORMAL_LOOP( inImg->height,
+
+      /* row sums before each column into the down-right sums */
+      rowSum = 0;
+      for (x = 0; x < width; ++x)
+      {
+        currRight[x] = x ? rowSum + prevRight[x - 1] : 0;
+        rowSum += ptrIn[x];
+      }
+
+      rowTotal  = rowSum;
+      prevTotal = allTotal;
+      allTotal += rowTotal;
+
+      /* row sums up to each column into the down-left sums */
+      for (x = width; x > 0; --x)
+      {
+        currLeft[x - 1] = rowSum + ((x < width) ? prevLeft[x] : prevTotal);
+        rowSum -= ptrIn[x - 1];
+      }
+
+      for (x = 0; x < width; ++x)
+      {
+        *ptrOut++ = currLeft[x] - currRight[x];
+      }
+
+      ptrIn += width;
+
+      swapTmp = prevLeft;  prevLeft  = currLeft;  currLeft  = swapTmp;
+      swapTmp = prevRight; prevRight = currRight; currRight = swapTmp;
+  )
+}
+
+
 /*
  * Convert the integral image to an 8 bit image
  *
@@ -82,7 +301,7 @@ void ConvertIntegralFeatureImage (Image8_t        *outImg,
   const size_t rowStep   = outImg->height / inImg->height;
   const size_t rowOffset = outImg->width * rowStep - inImg->width * colStep;
 
-  const size_t *ptrIn = inImg->data;
+  const uint32_t *ptrIn = inImg->data;
 
   uint8_t *ptrOut = outImg->data
                         + ((outImg->width - inImg->width * colStep) >> 1)
@@ -123,18 +342,18 @@ void IntegralFeatureUpDown (Image32_t       *outImg,
                             const size_t     colStep,
                             const size_t     rowStep)
 {
-  const size_t *ptrInUpperLeft   = inImg->data;
-  const size_t *ptrInCenterLeft  = inImg->data + boxHeight * inImg->width;
-  const size_t *ptrInLowerLeft   = inImg->data
+  const uint32_t *ptrInUpperLeft   = inImg->data;
+  const uint32_t *ptrInCenterLeft  = inImg->data + boxHeight * inImg->width;
+  const uint32_t *ptrInLowerLeft   = inImg->data
                                        + ((boxHeight * inImg->width) << 1);
-  const size_t *ptrInUpperRight  = ptrInUpperLeft + boxWidth;
-  const size_t *ptrInCenterRight = ptrInCenterLeft + boxWidth;
-  const size_t *ptrInLowerRight  = ptrInLowerLeft + boxWidth;
+  const uint32_t *ptrInUpperRight  = ptrInUpperLeft + boxWidth;
+  const uint32_t *ptrInCenterRight = ptrInCenterLeft + boxWidth;
+  const uint32_t *ptrInLowerRight  = ptrInLowerLeft + boxWidth;
 
   const size_t numColSteps = (inImg->width - boxWidth) / colStep;
   const size_t rowOffset   = inImg->width * rowStep - numColSteps * colStep;
 
-  size_t *ptrOut = outImg->data;
+  uint32_t *ptrOut = outImg->data;
 
   size_t upperBoxSum, lowerBoxSum, diffValue, diffMax = 0;
 
@@ -193,18 +412,18 @@ void IntegralFeatureLeftRight (Image32_t       *outImg,
                                const size_t     colStep,
                                const size_t     rowStep)
 {
-  const size_t *ptrInUpperLeft   = inImg->data;
-  const size_t *ptrInUpperCenter = inImg->data + boxWidth;
-  const size_t *ptrInUpperRight  = inImg->data + (boxWidth << 1);
+  const uint32_t *ptrInUpperLeft   = inImg->data;
+  const uint32_t *ptrInUpperCenter = inImg->data + boxWidth;
+  const uint32_t *ptrInUpperRight  = inImg->data + (boxWidth << 1);
 
-  const size_t *ptrInLowerLeft   = inImg->data + (boxHeight * inImg->width);
-  const size_t *ptrInLowerCenter = ptrInLowerLeft + boxWidth;
-  const size_t *ptrInLowerRight  = ptrInLowerLeft + (boxWidth << 1);
+  const uint32_t *ptrInLowerLeft   = inImg->data + (boxHeight * inImg->width);
+  const uint32_t *ptrInLowerCenter = ptrInLowerLeft + boxWidth;
+  const uint32_t *ptrInLowerRight  = ptrInLowerLeft + (boxWidth << 1);
 
   const size_t numColSteps = (inImg->width - (boxWidth << 1)) / colStep;
   const size_t rowOffset   = inImg->width * rowStep - numColSteps * colStep;
 
-  size_t *ptrOut = outImg->data;
+  uint32_t *ptrOut = outImg->data;
 
   size_t leftBoxSum, rightBoxSum, diffValue, diffMax = 0;
 
@@ -265,24 +484,24 @@ void IntegralFeatureDiagonal (Image32_t       *outImg,
                               const size_t     rowStep)
 {
   /* top row */
-  const size_t *ptrIn00 = inImg->data;
-  const size_t *ptrIn01 = ptrIn00 + boxWidth;
-  const size_t *ptrIn02 = ptrIn01 + boxWidth;
+  const uint32_t *ptrIn00 = inImg->data;
+  const uint32_t *ptrIn01 = ptrIn00 + boxWidth;
+  const uint32_t *ptrIn02 = ptrIn01 + boxWidth;
 
   /* middle row */
-  const size_t *ptrIn10 = ptrIn00 + boxHeight * inImg->width;
-  const size_t *ptrIn11 = ptrIn10 + boxWidth;
-  const size_t *ptrIn12 = ptrIn11 + boxWidth;
+  const uint32_t *ptrIn10 = ptrIn00 + boxHeight * inImg->width;
+  const uint32_t *ptrIn11 = ptrIn10 + boxWidth;
+  const uint32_t *ptrIn12 = ptrIn11 + boxWidth;
 
   /* bottom row */
-  const size_t *ptrIn20 = ptrIn10 + boxHeight * inImg->width;
-  const size_t *ptrIn21 = ptrIn20 + boxWidth;
-  const size_t *ptrIn22 = ptrIn21 + boxWidth;
+  const uint32_t *ptrIn20 = ptrIn10 + boxHeight * inImg->width;
+  const uint32_t *ptrIn21 = ptrIn20 + boxWidth;
+  const uint32_t *ptrIn22 = ptrIn21 + boxWidth;
 
   const size_t numColSteps = (inImg->width - (boxWidth << 1)) / colStep;
   const size_t rowOffset   = inImg->width * rowStep - numColSteps * colStep;
 
-  size_t *ptrOut = outImg->data;
+  uint32_t *ptrOut = outImg->data;
 
   /* BLACK WHITE
    * WHITE BLACK
@@ -333,3 +552,599 @@ void IntegralFeatureDiagonal (Image32_t       *outImg,
   }
 }
 
+
+
+/*
+ * Tilted integral image feature of two boxes rotated 45 degrees
+ *
+ * This is IntegralFeatureUpDown() rotated clockwise by 45 degrees. It
+ * detects edges along the diagonal from upper left to lower right.
+ *
+ * A tilted box has its top corner at (x, y) in the rotated integral image.
+ * The box width runs down and to the right and the box height runs down and
+ * to the left. The sum of the 2*w*h pixels inside is:
+ *
+ *   tilted(x, y) - tilted(x + w, y + w)
+ *                - tilted(x - h, y + h) + tilted(x + w - h, y + w + h)
+ *
+ * The second box is below the first along the height direction. The window
+ * is w + 2*h pixels wide and high. The output image is packed like the
+ * other feature images and indexed by the upper left corner of the window.
+ *
+ */
+void IntegralFeatureTiltedUpDown (Image32_t       *outImg,
+                                  size_t          *outMaxValue,
+                                  const Image32_t *inImg,
+                                  const size_t     boxWidth,
+                                  const size_t     boxHeight,
+                                  const size_t     colStep,
+                                  const size_t     rowStep)
+{
+  const size_t width      = inImg->width;
+  const size_t windowSize = boxWidth + (boxHeight << 1);
+
+  /* top corner of the upper box, then corners down each side */
+  const uint32_t *ptrInTop   = inImg->data + (boxHeight << 1);
+  const uint32_t *ptrInRight = ptrInTop + boxWidth * (width + 1);
+  const uint32_t *ptrInLeft  = ptrInTop + boxHeight * (width - 1);
+  const uint32_t *ptrInMid   = ptrInLeft + boxWidth * (width + 1);
+  const uint32_t *ptrInLower = ptrInLeft + boxHeight * (width - 1);
+  const uint32_t *ptrInBot   = ptrInMid + boxHeight * (width - 1);
+
+  const size_t numColSteps = (width - windowSize) / colStep;
+  const size_t rowOffset   = width * rowStep - numColSteps * colStep;
+
+  uint32_t *ptrOut = outImg->data;
+
+  size_t upperBoxSum, lowerBoxSum, diffValue, diffMax = 0;
+
+  NORMAL_LOOP( (inImg->height - windowSize) / rowStep,
+
+      UNROLL_LOOP( numColSteps,
+
+          upperBoxSum = *ptrInTop + *ptrInMid - (*ptrInRight + *ptrInLeft);
+          lowerBoxSum = *ptrInLeft + *ptrInBot - (*ptrInMid + *ptrInLower);
+
+          *ptrOut++ = diffValue = UINTDIFF(upperBoxSum, lowerBoxSum);
+
+          if (diffValue > diffMax)
+          {
+            diffMax = diffValue;
+          }
+
+          ptrInTop   += colStep;
+          ptrInRight += colStep;
+          ptrInLeft  += colStep;
+          ptrInMid   += colStep;
+          ptrInLower += colStep;
+          ptrInBot   += colStep;
+      )
+
+      ptrInTop   += rowOffset;
+      ptrInRight += rowOffset;
+      ptrInLeft  += rowOffset;
+      ptrInMid   += rowOffset;
+      ptrInLower += rowOffset;
+      ptrInBot   += rowOffset;
+  )
+
+  if (outMaxValue)
+  {
+    *outMaxValue = diffMax;
+  }
+}
+
+
+/*
+ * Tilted integral image feature of two boxes rotated 45 degrees
+ *
+ * This is IntegralFeatureLeftRight() rotated clockwise by 45 degrees. It
+ * detects edges along the diagonal from upper right to lower left. The
+ * second box is next to the first along the width direction. The window is
+ * 2*w + h pixels wide and high.
+ *
+ */
+void IntegralFeatureTiltedLeftRight (Image32_t       *outImg,
+                                     size_t          *outMaxValue,
+                                     const Image32_t *inImg,
+                                     const size_t     boxWidth,
+                                     const size_t     boxHeight,
+                                     const size_t     colStep,
+                                     const size_t     rowStep)
+{
+  const size_t width      = inImg->width;
+  const size_t windowSize = (boxWidth << 1) + boxHeight;
+
+  /* top corner of the left box, then corners down each side */
+  const uint32_t *ptrInTop   = inImg->data + boxHeight;
+  const uint32_t *ptrInLeft  = ptrInTop + boxHeight * (width - 1);
+  const uint32_t *ptrInMid   = ptrInTop + boxWidth * (width + 1);
+  const uint32_t *ptrInRight = ptrInMid + boxWidth * (width + 1);
+  const uint32_t *ptrInLower = ptrInLeft + boxWidth * (width + 1);
+  const uint32_t *ptrInBot   = ptrInLower + boxWidth * (width + 1);
+
+  const size_t numColSteps = (width - windowSize) / colStep;
+  const size_t rowOffset   = width * rowStep - numColSteps * colStep;
+
+  uint32_t *ptrOut = outImg->data;
+
+  size_t leftBoxSum, rightBoxSum, diffValue, diffMax = 0;
+
+  NORMAL_LOOP( (inImg->height - windowSize) / rowStep,
+
+      UNROLL_LOOP( numColSteps,
+
+          leftBoxSum  = *ptrInTop + *ptrInLower - (*ptrInMid + *ptrInLeft);
+          rightBoxSum = *ptrInMid + *ptrInBot - (*ptrInRight + *ptrInLower);
+
+          *ptrOut++ = diffValue = UINTDIFF(leftBoxSum, rightBoxSum);
+
+          if (diffValue > diffMax)
+          {
+            diffMax = diffValue;
+          }
+
+          ptrInTop   += colStep;
+          ptrInLeft  += colStep;
+          ptrInMid   += colStep;
+          ptrInRight += colStep;
+          ptrInLower += colStep;
+          ptrInBot   += colStep;
+      )
+
+      ptrInTop   += rowOffset;
+      ptrInLeft  += rowOffset;
+      ptrInMid   += rowOffset;
+      ptrInRight += rowOffset;
+      ptrInLower += rowOffset;
+      ptrInBot   += rowOffset;
+  )
+
+  if (outMaxValue)
+  {
+    *outMaxValue = diffMax;
+  }
+}
+
+
+/*
+ * Up/down, left/right and diagonal features together in one pass
+ *
+ * The three features share the same two by two arrangement of boxes. The
+ * up/down feature is the left column of boxes, the left/right feature is the
+ * top row of boxes and the diagonal feature is all four. So the nine corners
+ * of the arrangement are read once per window instead of six, six and nine
+ * times by the separate functions.
+ *
+ * All three outputs cover the windows where the whole arrangement fits, so
+ * they have the dimensions of the diagonal feature image. Planar output is
+ * three images: outImgs[0] is up/down, outImgs[1] is left/right and
+ * outImgs[2] is diagonal. Interleaved output is the single image outImgs[0]
+ * three times as wide with the up/down, left/right and diagonal values for
+ * each window next to each other. The three maximum values are optional and
+ * are in the same order.
+ *
+ */
+void IntegralFeatureFused (Image32_t       *outImgs,
+                           size_t          *outMaxValues,
+                           const Image32_t *inImg,
+                           const size_t     boxWidth,
+                           const size_t     boxHeight,
+                           const size_t     colStep,
+                           const size_t     rowStep,
+                           const int        interleaved)
+{
+  /* top row */
+  const uint32_t *ptrIn00 = inImg->data;
+  const uint32_t *ptrIn01 = ptrIn00 + boxWidth;
+  const uint32_t *ptrIn02 = ptrIn01 + boxWidth;
+
+  /* middle row */
+  const uint32_t *ptrIn10 = ptrIn00 + boxHeight * inImg->width;
+  const uint32_t *ptrIn11 = ptrIn10 + boxWidth;
+  const uint32_t *ptrIn12 = ptrIn11 + boxWidth;
+
+  /* bottom row */
+  const uint32_t *ptrIn20 = ptrIn10 + boxHeight * inImg->width;
+  const uint32_t *ptrIn21 = ptrIn20 + boxWidth;
+  const uint32_t *ptrIn22 = ptrIn21 + boxWidth;
+
+  const size_t numColSteps = (inImg->width - (boxWidth << 1)) / colStep;
+  const size_t rowOffset   = inImg->width * rowStep - numColSteps * colStep;
+
+  /* interleaved outputs are next to each other in one image */
+  const size_t outStride = interleaved ? 3 : 1;
+
+  uint32_t *ptrOutUD = outImgs[0].data;
+  uint32_t *ptrOutLR = interleaved ? ptrOutUD + 1 : outImgs[1].data;
+  uint32_t *ptrOutDG = interleaved ? ptrOutUD + 2 : outImgs[2].data;
+
+  size_t in00, in01, in02, in10, in11, in12, in20, in21, in22;
+  size_t box00, box01, box10, box11;
+  size_t diffValue, maxUD = 0, maxLR = 0, maxDG = 0;
+
+  NORMAL_LOOP( (inImg->height - (boxHeight << 1)) / rowStep,
+
+      UNROLL_LOOP( numColSteps,
+
+          in00 = *ptrIn00; in01 = *ptrIn01; in02 = *ptrIn02;
+          in10 = *ptrIn10; in11 = *ptrIn11; in12 = *ptrIn12;
+          in20 = *ptrIn20; in21 = *ptrIn21; in22 = *ptrIn22;
+
+          /* sums of the four boxes */
+          box00 = in00 + in11 - (in01 + in10);
+          box01 = in01 + in12 - (in02 + in11);
+          box10 = in10 + in21 - (in11 + in20);
+          box11 = in11 + in22 - (in12 + in21);
+
+          *ptrOutUD = diffValue = UINTDIFF(box00, box10);
+          if (diffValue > maxUD)
+          {
+            maxUD = diffValue;
+          }
+
+          *ptrOutLR = diffValue = UINTDIFF(box00, box01);
+          if (diffValue > maxLR)
+          {
+            maxLR = diffValue;
+          }
+
+          /* BLACK WHITE
+           * WHITE BLACK
+           */
+          *ptrOutDG = diffValue = UINTDIFF(box01 + box10, box00 + box11);
+          if (diffValue > maxDG)
+          {
+            maxDG = diffValue;
+          }
+
+          ptrOutUD += outStride;
+          ptrOutLR += outStride;
+          ptrOutDG += outStride;
+
+          ptrIn00 += colStep;
+          ptrIn01 += colStep;
+          ptrIn02 += colStep;
+          ptrIn10 += colStep;
+          ptrIn11 += colStep;
+          ptrIn12 += colStep;
+          ptrIn20 += colStep;
+          ptrIn21 += colStep;
+          ptrIn22 += colStep;
+      )
+
+      ptrIn00 += rowOffset;
+      ptrIn01 += rowOffset;
+      ptrIn02 += rowOffset;
+      ptrIn10 += rowOffset;
+      ptrIn11 += rowOffset;
+      ptrIn12 += rowOffset;
+      ptrIn20 += rowOffset;
+      ptrIn21 += rowOffset;
+      ptrIn22 += rowOffset;
+  )
+
+  if (outMaxValues)
+  {
+    outMaxValues[0] = maxUD;
+    outMaxValues[1] = maxLR;
+    outMaxValues[2] = maxDG;
+  }
+}
+
+
+/*
+ * Dimensions of the feature image for one scale of a multi-scale scan
+ *
+ * These are the same as the output of the single scale feature functions.
+ *
+ */
+void IntegralScaleSize (size_t                *outWidth,
+                        size_t                *outHeight,
+                        const Image32_t       *inImg,
+                        const IntegralScale_t *inScale)
+{
+  /* the feature window is two boxes wide and/or two boxes high */
+  const size_t windowWidth  = (inScale->feature == ECV_FEATURE_UPDOWN)
+                                  ? inScale->boxWidth
+                                  : (inScale->boxWidth << 1);
+  const size_t windowHeight = (inScale->feature == ECV_FEATURE_LEFTRIGHT)
+                                  ? inScale->boxHeight
+                                  : (inScale->boxHeight << 1);
+
+  *outWidth  = (inImg->width > windowWidth)
+                   ? (inImg->width - windowWidth) / inScale->colStep
+                   : 0;
+  *outHeight = (inImg->height > windowHeight)
+                   ? (inImg->height - windowHeight) / inScale->rowStep
+                   : 0;
+}
+
+
+/*
+ * One row of a box feature image
+ *
+ * The input pointer is the upper left corner of the first feature window in
+ * the integral image. This computes the same values as the single scale
+ * feature functions.
+ *
+ */
+static void IntegralFeatureRow (uint32_t              *outRow,
+                                size_t                *inoutMax,
+                                const uint32_t        *ptrIn00,
+                                const size_t           imgWidth,
+                                const IntegralScale_t *inScale,
+                                const size_t           numColSteps)
+{
+  const size_t boxWidth  = inScale->boxWidth;
+  const size_t colStep   = inScale->colStep;
+  const size_t boxOffset = inScale->boxHeight * imgWidth;
+
+  /* corners of up to two by two boxes */
+  const uint32_t *ptrIn01 = ptrIn00 + boxWidth;
+  const uint32_t *ptrIn02 = ptrIn01 + boxWidth;
+  const uint32_t *ptrIn10 = ptrIn00 + boxOffset;
+  const uint32_t *ptrIn11 = ptrIn10 + boxWidth;
+  const uint32_t *ptrIn12 = ptrIn11 + boxWidth;
+  const uint32_t *ptrIn20 = ptrIn10 + boxOffset;
+  const uint32_t *ptrIn21 = ptrIn20 + boxWidth;
+  const uint32_t *ptrIn22 = ptrIn21 + boxWidth;
+
+  size_t boxSum1, boxSum2, diffValue, diffMax = *inoutMax;
+
+  if (inScale->feature == ECV_FEATURE_UPDOWN)
+  {
+    /* two boxes stacked vertically, left corners and middle column */
+    UNROLL_LOOP( numColSteps,
+
+        boxSum1 = *ptrIn00 + *ptrIn11 - (*ptrIn01 + *ptrIn10);
+        boxSum2 = *ptrIn10 + *ptrIn21 - (*ptrIn11 + *ptrIn20);
+
+        *outRow++ = diffValue = UINTDIFF(boxSum1, boxSum2);
+
+        if (diffValue > diffMax)
+        {
+          diffMax = diffValue;
+        }
+
+        ptrIn00 += colStep;
+        ptrIn01 += colStep;
+        ptrIn10 += colStep;
+        ptrIn11 += colStep;
+        ptrIn20 += colStep;
+        ptrIn21 += colStep;
+    )
+  }
+  else if (inScale->feature == ECV_FEATURE_LEFTRIGHT)
+  {
+    /* two boxes side by side, top and middle rows */
+    UNROLL_LOOP( numColSteps,
+
+        boxSum1 = *ptrIn00 + *ptrIn11 - (*ptrIn01 + *ptrIn10);
+        boxSum2 = *ptrIn01 + *ptrIn12 - (*ptrIn02 + *ptrIn11);
+
+        *outRow++ = diffValue = UINTDIFF(boxSum1, boxSum2);
+
+        if (diffValue > diffMax)
+        {
+          diffMax = diffValue;
+        }
+
+        ptrIn00 += colStep;
+        ptrIn01 += colStep;
+        ptrIn02 += colStep;
+        ptrIn10 += colStep;
+        ptrIn11 += colStep;
+        ptrIn12 += colStep;
+    )
+  }
+  else
+  {
+    /* four boxes, BLACK WHITE over WHITE BLACK */
+    UNROLL_LOOP( numColSteps,
+
+        boxSum1 = *ptrIn00 + *ptrIn22 - *ptrIn02 - *ptrIn20;
+        boxSum2 = *ptrIn01 + *ptrIn10 + *ptrIn12 + *ptrIn21
+                      - *ptrIn02 - *ptrIn20 - (*ptrIn11 << 1);
+
+        *outRow++ = diffValue = UINTDIFF(boxSum2, boxSum1 - boxSum2);
+
+        if (diffValue > diffMax)
+        {
+          diffMax = diffValue;
+        }
+
+        ptrIn00 += colStep;
+        ptrIn01 += colStep;
+        ptrIn02 += colStep;
+        ptrIn10 += colStep;
+        ptrIn11 += colStep;
+        ptrIn12 += colStep;
+        ptrIn20 += colStep;
+        ptrIn21 += colStep;
+        ptrIn22 += colStep;
+    )
+  }
+
+  *inoutMax = diffMax;
+}
+
+
+/*
+ * Box feature images for many scales in one pass over the integral image
+ *
+ * Each scale has its own feature type, box size and step. The output image
+ * for each scale must have the dimensions from IntegralScaleSize() and
+ * receives the same values as the single scale feature functions would
+ * produce. The maximum feature value for each scale is optional.
+ *
+ * Instead of sweeping the whole integral image once per scale, the rows are
+ * visited once from top to bottom. At every row, each scale with a feature
+ * window starting there fills in one output row. So the rows a window spans
+ * are read by all the scales while they are still in the cache. The scale
+ * list is typically set up once and reused for every frame.
+ *
+ */
+void IntegralFeatureScan (Image32_t             *outImgs,
+                          size_t                *outMaxValues,
+                          const Image32_t       *inImg,
+                          const IntegralScale_t *inScales,
+                          const size_t           numScales)
+{
+  size_t outWidth[numScales], outHeight[numScales], outRow[numScales];
+  size_t maxValue[numScales];
+
+  size_t row, i, numRows = 0;
+
+  for (i = 0; i < numScales; ++i)
+  {
+    IntegralScaleSize(outWidth + i, outHeight + i, inImg, inScales + i);
+    outRow[i]   = 0;
+    maxValue[i] = 0;
+
+    /* last integral image row any window of this scale starts on */
+    if (outHeight[i] && ((outHeight[i] - 1) * inScales[i].rowStep >= numRows))
+    {
+      numRows = (outHeight[i] - 1) * inScales[i].rowStep + 1;
+    }
+  }
+
+  for (row = 0; row < numRows; ++row)
+  {
+    for (i = 0; i < numScales; ++i)
+    {
+      if ( (outRow[i] == outHeight[i])
+           || (row != outRow[i] * inScales[i].rowStep) )
+      {
+        continue;
+      }
+
+      IntegralFeatureRow(outImgs[i].data + outRow[i] * outWidth[i],
+                         maxValue + i,
+                         inImg->data + row * inImg->width,
+                         inImg->width,
+                         inScales + i,
+                         outWidth[i]);
+
+      outRow[i]++;
+    }
+  }
+
+  if (outMaxValues)
+  {
+    memcpy(outMaxValues, maxValue, sizeof(size_t) * numScales);
+  }
+}
+
+
+/*
+ * Integral image feature limited to the changed blocks of a change map
+ *
+ * This is the same as one scale of IntegralFeatureScan() except that only
+ * windows overlapping a changed block are computed. Other windows hold the
+ * same pixels as before so their feature values are left alone. The output
+ * image dimensions are given by IntegralScaleSize(). The maximum value is
+ * over the computed windows only.
+ *
+ * A window covers many blocks so the change map is summed into a small
+ * integral image first. Testing a window is then four look ups. Runs of
+ * windows along a row that need computing are done together.
+ *
+ */
+void IntegralFeatureMasked (Image32_t             *outImg,
+                            size_t                *outMaxValue,
+                            const Image32_t       *inImg,
+                            const Image8_t        *inChangeMap,
+                            const IntegralScale_t *inScale)
+{
+  const size_t mapWidth  = inChangeMap->width;
+  const size_t mapHeight = inChangeMap->height;
+  const size_t sumWidth  = mapWidth + 1;
+
+  /* the feature window is two boxes wide and/or two boxes high */
+  const size_t windowWidth  = (inScale->feature == ECV_FEATURE_UPDOWN)
+                                  ? inScale->boxWidth
+                                  : (inScale->boxWidth << 1);
+  const size_t windowHeight = (inScale->feature == ECV_FEATURE_LEFTRIGHT)
+                                  ? inScale->boxHeight
+                                  : (inScale->boxHeight << 1);
+
+  /* integral image of the change map with a row and column of zeros */
+  size_t mapSum[(mapHeight + 1) * sumWidth];
+
+  const uint8_t *ptrMap = inChangeMap->data;
+
+  size_t outWidth, outHeight, row, col, runBegin, accum;
+  size_t blockRow0, blockRow1, blockCol0, blockCol1;
+  size_t maxValue = 0;
+
+  memset(mapSum, 0, sizeof(size_t) * sumWidth);
+
+  for (row = 1; row <= mapHeight; ++row)
+  {
+    accum = 0;
+    mapSum[row * sumWidth] = 0;
+
+    for (col = 1; col <= mapWidth; ++col)
+    {
+      accum += (*ptrMap++ != 0);
+      mapSum[row * sumWidth + col] = mapSum[(row - 1) * sumWidth + col]
+                                     + accum;
+    }
+  }
+
+  IntegralScaleSize(&outWidth, &outHeight, inImg, inScale);
+
+  for (row = 0; row < outHeight; ++row)
+  {
+    /* window at integral image corner covers pixels one down and right */
+    blockRow0 = (row * inScale->rowStep + 1) >> CHANGEMAP_SHIFT;
+    blockRow1 = ((row * inScale->rowStep + windowHeight) >> CHANGEMAP_SHIFT)
+                + 1;
+
+    runBegin = outWidth;
+
+    for (col = 0; col <= outWidth; ++col)
+    {
+      if (col < outWidth)
+      {
+        blockCol0 = (col * inScale->colStep + 1) >> CHANGEMAP_SHIFT;
+        blockCol1 = ((col * inScale->colStep + windowWidth)
+                         >> CHANGEMAP_SHIFT) + 1;
+
+        if ( mapSum[blockRow1 * sumWidth + blockCol1]
+             + mapSum[blockRow0 * sumWidth + blockCol0]
+             != mapSum[blockRow0 * sumWidth + blockCol1]
+                + mapSum[blockRow1 * sumWidth + blockCol0] )
+        {
+          /* window overlaps a changed block */
+          if (runBegin == outWidth)
+          {
+            runBegin = col;
+          }
+
+          continue;
+        }
+      }
+
+      /* end of a run of windows to compute */
+      if (runBegin < col)
+      {
+        IntegralFeatureRow(outImg->data + row * outWidth + runBegin,
+                           &maxValue,
+                           inImg->data + row * inScale->rowStep * inImg->width
+                               + runBegin * inScale->colStep,
+                           inImg->width,
+                           inScale,
+                           col - runBegin);
+      }
+
+      runBegin = outWidth;
+    }
+  }
+
+  if (outMaxValue)
+  {
+    *outMaxValue = maxValue;
+  }
+}
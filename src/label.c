@@ -0,0 +1,349 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/*
+ * Find the root label of a provisional label with path halving
+ *
+ */
+static uint16_t FindRootLabel (uint16_t *parent, uint16_t label)
+{
+  while (parent[label] != label)
+  {
+    parent[label] = parent[ parent[label] ];
+    label = parent[label];
+  }
+
+  return label;
+}
+
+
+/*
+ * Add the statistics of one run of pixels to a blob
+ *
+ */
+static void AddRunToBlob (Blob_t        *blob,
+                          const size_t   begin,  /* first column of run */
+                          const size_t   end,    /* one past last column */
+                          const size_t   row)
+{
+  const size_t length = end - begin;
+
+  blob->area += length;
+  blob->sumX += ((begin + end - 1) * length) >> 1;
+  blob->sumY += row * length;
+
+  if (begin < blob->minX)
+  {
+    blob->minX = begin;
+  }
+
+  if (end - 1 > blob->maxX)
+  {
+    blob->maxX = end - 1;
+  }
+
+  blob->maxY = row;  /* rows are visited in order */
+}
+
+
+/*
+ * Connected component labeling of a segmented image
+ *
+ * Pixels are connected if they are neighbors and have the same value. Zero
+ * valued pixels are background and never labeled. Neighbors are the four
+ * pixels up, down, left and right or, if eightConnected is set, all eight
+ * surrounding pixels.
+ *
+ * Every row is broken into runs of pixels with the same value. Each run is
+ * compared only with the runs in the row above that it touches. Labels are
+ * merged with union-find so the image is scanned exactly once. The blob area,
+ * bounding box and first order moments are accumulated during the same scan
+ * by adding in each run as it is found. The cost is proportional to the
+ * number of pixels and runs.
+ *
+ * The output label image is optional. If present, it needs the same
+ * dimensions as the input image. Label 0 is background and label L
+ * corresponds to outBlobs->blobs[L - 1]. The label image costs an extra pass
+ * to replace provisional labels with final ones.
+ *
+ * Provisional labels are limited by the capacity of the blob list (at most
+ * 65535). Once exhausted, new runs that do not touch an existing blob are
+ * left unlabeled and are not counted.
+ *
+ */
+size_t LabelImage (Image16_t      *outImg,
+                   BlobList_t     *outBlobs,
+                   const Image8_t *inImg,
+                   const int       eightConnected)
+{
+  const size_t width   = inImg->width;
+  const size_t height  = inImg->height;
+  const size_t reach   = eightConnected ? 1 : 0;
+  const size_t maxBlob = (outBlobs->maxBlobs < 65535)
+                             ? outBlobs->maxBlobs : 65535;
+
+  Blob_t   *blobs  = outBlobs->blobs;
+  uint16_t *parent = outBlobs->parent;
+
+  /* runs for the previous and current rows */
+  size_t   runBeginA[width], runEndA[width];
+  size_t   runBeginB[width], runEndB[width];
+  uint16_t runLabelA[width], runLabelB[width];
+  uint8_t  runValueA[width], runValueB[width];
+
+  size_t   *prevBegin = runBeginA, *currBegin = runBeginB;
+  size_t   *prevEnd   = runEndA,   *currEnd   = runEndB;
+  uint16_t *prevLabel = runLabelA, *currLabel = runLabelB;
+  uint8_t  *prevValue = runValueA, *currValue = runValueB;
+  size_t    numPrev   = 0,          numCurr   = 0;
+
+  void *swapTmp;
+
+  const uint8_t *ptrIn  = inImg->data;
+  uint16_t      *ptrOut = outImg ? outImg->data : 0;
+
+  size_t   numLabels = 0;
+  size_t   row, col, begin, i, j, first;
+  uint8_t  value;
+  uint16_t label, root, other;
+
+  parent[0] = 0;
+
+  for (row = 0; row < height; ++row)
+  {
+    /* break the row into runs of the same nonzero value */
+    numCurr = 0;
+    col     = 0;
+
+    while (col < width)
+    {
+      value = ptrIn[col];
+      begin = col;
+
+      while ( (++col < width) && (ptrIn[col] == value) )
+      {
+      }
+
+      if (value)
+      {
+        currBegin[numCurr] = begin;
+        currEnd[numCurr]   = col;
+        currValue[numCurr] = value;
+        numCurr++;
+      }
+    }
+
+    /* connect the runs to touching runs in the row above */
+    first = 0;
+
+    for (i = 0; i < numCurr; ++i)
+    {
+      label = 0;
+
+      /* runs above that end before this one begins are done with */
+      while ( (first < numPrev)
+              && (prevEnd[first] + reach <= currBegin[i]) )
+      {
+        first++;
+      }
+
+      for (j = first;
+           (j < numPrev) && (prevBegin[j] < currEnd[i] + reach);
+           ++j)
+      {
+        if ( (prevValue[j] != currValue[i]) || (! prevLabel[j]) )
+        {
+          continue;
+        }
+
+        root = FindRootLabel(parent, prevLabel[j]);
+
+        if (! label)
+        {
+          label = root;
+        }
+        else if (root != label)
+        {
+          /* merge, the smaller label is always the root */
+          other = FindRootLabel(parent, label);
+          if (root < other)
+          {
+            parent[other] = root;
+            label = root;
+          }
+          else if (other < root)
+          {
+            parent[root] = other;
+            label = other;
+          }
+        }
+      }
+
+      /* a new blob */
+      if ( (! label) && (numLabels < maxBlob) )
+      {
+        label = ++numLabels;
+        parent[label] = label;
+
+        blobs[label - 1].value = currValue[i];
+        blobs[label - 1].area  = 0;
+        blobs[label - 1].sumX  = 0;
+        blobs[label - 1].sumY  = 0;
+        blobs[label - 1].minX  = currBegin[i];
+        blobs[label - 1].maxX  = currBegin[i];
+        blobs[label - 1].minY  = row;
+        blobs[label - 1].maxY  = row;
+      }
+
+      if (label)
+      {
+        AddRunToBlob(blobs + label - 1, currBegin[i], currEnd[i], row);
+      }
+
+      currLabel[i] = label;
+    }
+
+    /* provisional labels into the output image */
+    if (ptrOut)
+    {
+      memset(ptrOut, 0, sizeof(uint16_t) * width);
+
+      for (i = 0; i < numCurr; ++i)
+      {
+        label = currLabel[i];
+        for (col = currBegin[i]; col < currEnd[i]; ++col)
+        {
+          ptrOut[col] = label;
+        }
+      }
+
+      ptrOut += width;
+    }
+
+    ptrIn += width;
+
+    /* current row becomes the previous row */
+    swapTmp = prevBegin; prevBegin = currBegin; currBegin = swapTmp;
+    swapTmp = prevEnd;   prevEnd   = currEnd;   currEnd   = swapTmp;
+    swapTmp = prevLabel; prevLabel = currLabel; currLabel = swapTmp;
+    swapTmp = prevValue; prevValue = currValue; currValue = swapTmp;
+    numPrev = numCurr;
+  }
+
+  /*
+   * Resolve provisional labels. As roots are always the smallest label in a
+   * set, every parent is visited before its children. One sweep flattens the
+   * trees. The next sweep numbers the roots and merges the statistics. The
+   * parent array then maps provisional labels to final labels.
+   */
+  for (i = 1; i <= numLabels; ++i)
+  {
+    parent[i] = parent[ parent[i] ];
+  }
+
+  size_t numBlobs = 0;
+  Blob_t *dst, *src;
+
+  for (i = 1; i <= numLabels; ++i)
+  {
+    src = blobs + i - 1;
+
+    if (parent[i] == i)
+    {
+      /* root label, final label is never larger than provisional label */
+      dst = blobs + numBlobs;
+      parent[i] = ++numBlobs;
+
+      if (dst != src)
+      {
+        *dst = *src;
+      }
+    }
+    else
+    {
+      /* the root was already given its final label */
+      parent[i] = parent[ parent[i] ];
+      dst = blobs + parent[i] - 1;
+
+      dst->area += src->area;
+      dst->sumX += src->sumX;
+      dst->sumY += src->sumY;
+
+      if (src->minX < dst->minX)
+      {
+        dst->minX = src->minX;
+      }
+
+      if (src->maxX > dst->maxX)
+      {
+        dst->maxX = src->maxX;
+      }
+
+      if (src->minY < dst->minY)
+      {
+        dst->minY = src->minY;
+      }
+
+      if (src->maxY > dst->maxY)
+      {
+        dst->maxY = src->maxY;
+      }
+    }
+  }
+
+  /* centroids from first order moments */
+  dst = blobs;
+
+  NORMAL_LOOP( numBlobs,
+
+      dst->centroidX = dst->sumX / dst->area;
+      dst->centroidY = dst->sumY / dst->area;
+      dst++;
+  )
+
+  /* final labels into the output image */
+  if (outImg)
+  {
+    ptrOut = outImg->data;
+
+    UNROLL_LOOP( width * height,
+
+        *ptrOut = parent[ *ptrOut ];
+        ptrOut++;
+    )
+  }
+
+  return outBlobs->numberBlobs = numBlobs;
+}
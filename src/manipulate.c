@@ -33,6 +33,13 @@
 #include "embedcv.h"
 
 
+/* fraction bits of the resampling filter weights */
+#define RESIZE_SHIFT 14
+
+/* square tile side for transposes, a tile of each image stays in cache */
+#define TRANSPOSE_TILE 16
+
+
 /*
  * Crop an 8 bit image from another image
  *
@@ -242,6 +249,253 @@ void UpsampleImage (Image8_t *outImg,
 }
 
 
+/*
+ * Resampling filter taps for one output dimension
+ *
+ * Every output sample is a weighted sum of a run of input samples. The run
+ * starts at outStart and has outCount samples with weights in outWeights.
+ * The weights of every output sample add up to exactly 1 << RESIZE_SHIFT.
+ *
+ * Bilinear taps interpolate between the two input samples nearest the
+ * output sample center. Area taps are the overlap of the output sample with
+ * every input sample it covers.
+ *
+ */
+static void ResizeTable (size_t          *outStart,
+                         size_t          *outCount,
+                         uint16_t        *outWeights,  /* inN + 2 outN */
+                         const size_t     outN,
+                         const size_t     inN,
+                         const EcvResize  mode)
+{
+  size_t   d, s, first, last, cover;
+  uint32_t prevCum, cum;
+  int64_t  pos;
+
+  for (d = 0; d < outN; ++d)
+  {
+    if (ECV_RESIZE_AREA == mode)
+    {
+      /* coordinates in units of 1 / outN input samples */
+      first = d * inN / outN;
+      last  = ((d + 1) * inN - 1) / outN;
+
+      prevCum = 0;
+
+      for (s = first; s <= last; ++s)
+      {
+        cover = ( ((s + 1) * outN < (d + 1) * inN) ? (s + 1) * outN
+                                                   : (d + 1) * inN )
+                - d * inN;
+        cum   = ( ((uint64_t)cover << RESIZE_SHIFT) + (inN >> 1) ) / inN;
+
+        *outWeights++ = cum - prevCum;
+        prevCum = cum;
+      }
+
+      outStart[d] = first;
+      outCount[d] = last - first + 1;
+    }
+    else
+    {
+      /* center of the output sample in input coordinates, 16 bit fraction */
+      pos = ( ((int64_t)(2 * d + 1) * inN) << 15 ) / outN - 32768;
+
+      if (pos < 0)
+      {
+        pos = 0;
+      }
+
+      first = pos >> 16;
+      cum   = ((pos & 0xffff) + (1 << (15 - RESIZE_SHIFT)))
+              >> (16 - RESIZE_SHIFT);
+
+      if (first >= inN - 1)
+      {
+        first = inN - 1;
+        cum   = 0;
+      }
+
+      outStart[d] = first;
+
+      if (cum)
+      {
+        *outWeights++ = (1 << RESIZE_SHIFT) - cum;
+        *outWeights++ = cum;
+        outCount[d] = 2;
+      }
+      else
+      {
+        *outWeights++ = 1 << RESIZE_SHIFT;
+        outCount[d] = 1;
+      }
+    }
+  }
+}
+
+
+/*
+ * Resample one input row horizontally with eight fraction bits
+ *
+ */
+static void ResizeRow (uint16_t        *outRow,
+                       const uint8_t   *inRow,
+                       const size_t     outWidth,
+                       const size_t     channels,
+                       const size_t    *inStart,
+                       const size_t    *inCount,
+                       const uint16_t  *inWeights)
+{
+  const uint8_t *ptrIn;
+
+  size_t   col, c, k;
+  uint32_t sum;
+
+  for (col = 0; col < outWidth; ++col)
+  {
+    for (c = 0; c < channels; ++c)
+    {
+      ptrIn = inRow + inStart[col] * channels + c;
+      sum   = 0;
+
+      for (k = 0; k < inCount[col]; ++k)
+      {
+        sum   += inWeights[k] * *ptrIn;
+        ptrIn += channels;
+      }
+
+      *outRow++ = (sum + (1 << (RESIZE_SHIFT - 9))) >> (RESIZE_SHIFT - 8);
+    }
+
+    inWeights += inCount[col];
+  }
+}
+
+
+/*
+ * Separable resampling of interleaved 8 bit channels
+ *
+ * The filter taps for the columns and rows are computed once. Every input
+ * row used is resampled horizontally once into a row cache and the output
+ * rows are then weighted sums of cached rows. Consecutive input rows go in
+ * alternate cache slots. Each output row only uses consecutive input rows
+ * and neighboring output rows share at most their boundary rows, so no row
+ * is resampled twice.
+ *
+ */
+static void ResizeChannels (uint8_t         *outData,
+                            const size_t     outWidth,
+                            const size_t     outHeight,
+                            const uint8_t   *inData,
+                            const size_t     inWidth,
+                            const size_t     inHeight,
+                            const size_t     channels,
+                            const EcvResize  mode)
+{
+  const size_t rowLength = outWidth * channels;
+
+  size_t   colStart[outWidth], colCount[outWidth];
+  uint16_t colWeights[inWidth + 2 * outWidth];
+  size_t   rowStart[outHeight], rowCount[outHeight];
+  uint16_t rowWeights[inHeight + 2 * outHeight];
+
+  /* horizontally resampled rows and the input row in each cache slot */
+  uint16_t cache[2][rowLength];
+  size_t   cacheRow[2] = { (size_t) -1, (size_t) -1 };
+  uint32_t sum[rowLength];
+
+  const uint16_t *ptrWeight = rowWeights;
+  const uint16_t *ptrCache;
+  const uint32_t *ptrSum;
+
+  size_t   row, k, x, inRow;
+  uint32_t weight;
+
+  ResizeTable(colStart, colCount, colWeights, outWidth, inWidth, mode);
+  ResizeTable(rowStart, rowCount, rowWeights, outHeight, inHeight, mode);
+
+  for (row = 0; row < outHeight; ++row)
+  {
+    for (k = 0; k < rowCount[row]; ++k)
+    {
+      inRow = rowStart[row] + k;
+
+      if (cacheRow[inRow & 1] != inRow)
+      {
+        ResizeRow(cache[inRow & 1], inData + inRow * inWidth * channels,
+                  outWidth, channels, colStart, colCount, colWeights);
+        cacheRow[inRow & 1] = inRow;
+      }
+
+      ptrCache = cache[inRow & 1];
+      weight   = *ptrWeight++;
+
+      if (k)
+      {
+        for (x = 0; x < rowLength; ++x)
+        {
+          sum[x] += weight * ptrCache[x];
+        }
+      }
+      else
+      {
+        for (x = 0; x < rowLength; ++x)
+        {
+          sum[x] = weight * ptrCache[x];
+        }
+      }
+    }
+
+    ptrSum = sum;
+
+    UNROLL_LOOP( rowLength,
+
+        *outData++ = (*ptrSum++ + (1 << (RESIZE_SHIFT + 7)))
+                         >> (RESIZE_SHIFT + 8);
+    )
+  }
+}
+
+
+/*
+ * Resize an 8 bit image to any dimensions
+ *
+ * Bilinear interpolation samples the input at the center of every output
+ * pixel. It is best for enlarging or reducing by less than half. Area
+ * averaging weights every input pixel by how much of it the output pixel
+ * covers. It is best for reducing as every input pixel contributes. The
+ * arithmetic is fixed point with 14 bit weights and results are rounded.
+ *
+ * The input and output images must not overlap. Temporary storage is a few
+ * output rows and the filter tables on the stack.
+ *
+ */
+void ResizeImage (Image8_t        *outImg,
+                  const Image8_t  *inImg,
+                  const EcvResize  mode)
+{
+  ResizeChannels(outImg->data, outImg->width, outImg->height,
+                 inImg->data, inImg->width, inImg->height, 1, mode);
+}
+
+
+/*
+ * Resize a packed 16 bit image to any dimensions
+ *
+ * The two bytes of every pixel are resampled independently as for packed
+ * CbCr images. This is not for 16 bit values.
+ *
+ */
+void ResizeImageW (Image16_t       *outImg,
+                   const Image16_t *inImg,
+                   const EcvResize  mode)
+{
+  ResizeChannels((uint8_t *) outImg->data, outImg->width, outImg->height,
+                 (const uint8_t *) inImg->data, inImg->width, inImg->height,
+                 2, mode);
+}
+
+
 /*
  * Flip an 8 bit image up / down
  *
@@ -358,6 +612,190 @@ void FlopImageW (Image16_t *outImg)
 }
 
 
+/*
+ * Transpose 8 bit pixels tile by tile
+ *
+ * Input row y column x goes to output row x column y. The strides may be
+ * negative to mirror the input or output rows which gives the rotations.
+ * Square tiles are copied whole so both the rows read and the rows written
+ * stay in cache, instead of striding down a whole column of the output for
+ * every input row.
+ *
+ */
+static void TransposeTiles (uint8_t         *outData,    /* output row 0 */
+                            const ptrdiff_t  outStride,
+                            const uint8_t   *inData,     /* input row 0 */
+                            const ptrdiff_t  inStride,
+                            const size_t     inWidth,
+                            const size_t     inHeight)
+{
+  const uint8_t *ptrIn;
+  uint8_t       *ptrOut;
+
+  size_t tileRow, tileCol, rows, cols, row;
+
+  for (tileRow = 0; tileRow < inHeight; tileRow += TRANSPOSE_TILE)
+  {
+    rows = (inHeight - tileRow < TRANSPOSE_TILE) ? inHeight - tileRow
+                                                 : TRANSPOSE_TILE;
+
+    for (tileCol = 0; tileCol < inWidth; tileCol += TRANSPOSE_TILE)
+    {
+      cols = (inWidth - tileCol < TRANSPOSE_TILE) ? inWidth - tileCol
+                                                  : TRANSPOSE_TILE;
+
+      for (row = 0; row < rows; ++row)
+      {
+        ptrIn  = inData + (ptrdiff_t)(tileRow + row) * inStride + tileCol;
+        ptrOut = outData + (ptrdiff_t)tileCol * outStride + tileRow + row;
+
+        UNROLL_LOOP( cols,
+
+            *ptrOut = *ptrIn++;
+            ptrOut += outStride;
+        )
+      }
+    }
+  }
+}
+
+
+/*
+ * Transpose 16 bit pixels tile by tile
+ *
+ */
+static void TransposeTilesW (uint16_t        *outData,    /* output row 0 */
+                             const ptrdiff_t  outStride,
+                             const uint16_t  *inData,     /* input row 0 */
+                             const ptrdiff_t  inStride,
+                             const size_t     inWidth,
+                             const size_t     inHeight)
+{
+  const uint16_t *ptrIn;
+  uint16_t       *ptrOut;
+
+  size_t tileRow, tileCol, rows, cols, row;
+
+  for (tileRow = 0; tileRow < inHeight; tileRow += TRANSPOSE_TILE)
+  {
+    rows = (inHeight - tileRow < TRANSPOSE_TILE) ? inHeight - tileRow
+                                                 : TRANSPOSE_TILE;
+
+    for (tileCol = 0; tileCol < inWidth; tileCol += TRANSPOSE_TILE)
+    {
+      cols = (inWidth - tileCol < TRANSPOSE_TILE) ? inWidth - tileCol
+                                                  : TRANSPOSE_TILE;
+
+      for (row = 0; row < rows; ++row)
+      {
+        ptrIn  = inData + (ptrdiff_t)(tileRow + row) * inStride + tileCol;
+        ptrOut = outData + (ptrdiff_t)tileCol * outStride + tileRow + row;
+
+        UNROLL_LOOP( cols,
+
+            *ptrOut = *ptrIn++;
+            ptrOut += outStride;
+        )
+      }
+    }
+  }
+}
+
+
+/*
+ * Transpose an 8 bit image
+ *
+ * The output image has the width and height of the input image swapped. The
+ * images must not overlap. Column oriented operations can run as a transpose,
+ * a row oriented operation and another transpose.
+ *
+ */
+void TransposeImage (Image8_t       *outImg,
+                     const Image8_t *inImg)
+{
+  TransposeTiles(outImg->data, outImg->width,
+                 inImg->data, inImg->width,
+                 inImg->width, inImg->height);
+}
+
+
+/*
+ * Transpose a 16 bit image
+ *
+ */
+void TransposeImageW (Image16_t       *outImg,
+                      const Image16_t *inImg)
+{
+  TransposeTilesW(outImg->data, outImg->width,
+                  inImg->data, inImg->width,
+                  inImg->width, inImg->height);
+}
+
+
+/*
+ * Rotate an 8 bit image 90 degrees clockwise
+ *
+ * This is the transpose of the image flipped up / down. The input rows are
+ * read from the bottom up during the transpose so it is still one pass. The
+ * output image has the width and height of the input image swapped and the
+ * images must not overlap.
+ *
+ */
+void RotateImage90 (Image8_t       *outImg,
+                    const Image8_t *inImg)
+{
+  TransposeTiles(outImg->data, outImg->width,
+                 inImg->data + (inImg->height - 1) * inImg->width,
+                 -(ptrdiff_t)inImg->width,
+                 inImg->width, inImg->height);
+}
+
+
+/*
+ * Rotate a 16 bit image 90 degrees clockwise
+ *
+ */
+void RotateImage90W (Image16_t       *outImg,
+                     const Image16_t *inImg)
+{
+  TransposeTilesW(outImg->data, outImg->width,
+                  inImg->data + (inImg->height - 1) * inImg->width,
+                  -(ptrdiff_t)inImg->width,
+                  inImg->width, inImg->height);
+}
+
+
+/*
+ * Rotate an 8 bit image 270 degrees clockwise (90 degrees counterclockwise)
+ *
+ * This is the transpose flipped up / down. The output rows are written from
+ * the bottom up during the transpose so it is still one pass.
+ *
+ */
+void RotateImage270 (Image8_t       *outImg,
+                     const Image8_t *inImg)
+{
+  TransposeTiles(outImg->data + (outImg->height - 1) * outImg->width,
+                 -(ptrdiff_t)outImg->width,
+                 inImg->data, inImg->width,
+                 inImg->width, inImg->height);
+}
+
+
+/*
+ * Rotate a 16 bit image 270 degrees clockwise (90 degrees counterclockwise)
+ *
+ */
+void RotateImage270W (Image16_t       *outImg,
+                      const Image16_t *inImg)
+{
+  TransposeTilesW(outImg->data + (outImg->height - 1) * outImg->width,
+                  -(ptrdiff_t)outImg->width,
+                  inImg->data, inImg->width,
+                  inImg->width, inImg->height);
+}
+
+
 /*
  * Convert a RGB image to YCbCr
  *
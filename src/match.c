@@ -0,0 +1,568 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/* smallest template side length searched at the top of a pyramid */
+#define MATCH_MIN_TEMPLATE 8
+
+
+/*
+ * Sums over the template needed for normalized cross correlation
+ *
+ */
+static void MatchTemplateSums (uint64_t       *outSum,
+                               uint64_t       *outSumSq,
+                               const Image8_t *inTemplate)
+{
+  const uint8_t *ptrTpl = inTemplate->data;
+
+  uint64_t sum = 0, sumSq = 0;
+
+  UNROLL_LOOP( inTemplate->width * inTemplate->height,
+
+      sum   += *ptrTpl;
+      sumSq += *ptrTpl * *ptrTpl;
+      ptrTpl++;
+  )
+
+  *outSum   = sum;
+  *outSumSq = sumSq;
+}
+
+
+/*
+ * Normalized cross correlation score from the window and template sums
+ *
+ * The score is 32768 * (1 - correlation) so 0 is a perfect match, 32768 is
+ * no correlation and 65536 is a perfect inverse. A flat window or template
+ * has no correlation.
+ *
+ */
+static uint32_t MatchNCCScore (const uint64_t numPixels,
+                               const uint64_t sumImg,
+                               const uint64_t sumSqImg,
+                               const uint64_t sumTpl,
+                               const uint64_t stdTpl,    /* scaled by n */
+                               const uint64_t sumCross)
+{
+  const uint64_t stdImg = UintSqrt64(numPixels * sumSqImg - sumImg * sumImg);
+
+  uint64_t product;
+  int64_t  cross, score;
+
+  if (! (stdImg && stdTpl))
+  {
+    return 32768;
+  }
+
+  cross   = (int64_t)(numPixels * sumCross) - (int64_t)(sumImg * sumTpl);
+  product = stdImg * stdTpl;
+
+  /*
+   * The standard deviation product grows with the square of the number of
+   * pixels and the cross term is no larger. Both are scaled down together
+   * until the cross term times 32768 fits in 63 bits.
+   */
+  while (product >= ((uint64_t)1 << 47))
+  {
+    product >>= 1;
+    cross    /= 2;
+  }
+
+  score = 32768 - (cross * 32768) / (int64_t)product;
+
+  /* integer square roots round down so the correlation may exceed one */
+  return (score < 0) ? 0 : (score > 65536) ? 65536 : score;
+}
+
+
+/*
+ * Match score of the template at one position in the image
+ *
+ * Everything is computed directly from the pixels. This is for sparse
+ * positions like the refinement steps of a coarse to fine search.
+ *
+ */
+static uint32_t MatchScoreAt (const Image8_t       *inImg,
+                              const Image8_t       *inTemplate,
+                              const size_t          col,
+                              const size_t          row,
+                              const EcvMatchMethod  method,
+                              const uint64_t        sumTpl,
+                              const uint64_t        stdTpl)
+{
+  const size_t tplWidth  = inTemplate->width;
+  const size_t tplHeight = inTemplate->height;
+
+  const uint8_t *ptrTpl = inTemplate->data;
+  const uint8_t *ptrImg;
+
+  uint64_t sum = 0, sumSq = 0, sumCross = 0;
+  uint32_t diff;
+  size_t   i;
+
+  for (i = 0; i < tplHeight; ++i)
+  {
+    ptrImg = inImg->data + (row + i) * inImg->width + col;
+
+    if (method == ECV_MATCH_SAD)
+    {
+      UNROLL_LOOP( tplWidth,
+
+          sum += UINTDIFF(*ptrImg, *ptrTpl);
+          ptrImg++;
+          ptrTpl++;
+      )
+    }
+    else if (method == ECV_MATCH_SSD)
+    {
+      UNROLL_LOOP( tplWidth,
+
+          diff = UINTDIFF(*ptrImg, *ptrTpl);
+          sum += diff * diff;
+          ptrImg++;
+          ptrTpl++;
+      )
+    }
+    else
+    {
+      UNROLL_LOOP( tplWidth,
+
+          sum      += *ptrImg;
+          sumSq    += *ptrImg * *ptrImg;
+          sumCross += *ptrImg * *ptrTpl;
+          ptrImg++;
+          ptrTpl++;
+      )
+    }
+  }
+
+  if (method != ECV_MATCH_NCC)
+  {
+    return (sum > UINT32_MAX) ? UINT32_MAX : sum;
+  }
+
+  return MatchNCCScore(tplWidth * tplHeight, sum, sumSq, sumTpl, stdTpl,
+                       sumCross);
+}
+
+
+/*
+ * Add a location to a list of the best matches
+ *
+ * The list is sorted by increasing score. Locations closer than the minimum
+ * distance to a better location are dropped. A new location replaces any
+ * worse locations that are too close.
+ *
+ */
+static void MatchInsert (MatchLocation_t *inoutBest,
+                         size_t          *inoutCount,
+                         const size_t     maxBest,
+                         const size_t     col,
+                         const size_t     row,
+                         const uint32_t   score,
+                         const size_t     minDistance)
+{
+  size_t count = *inoutCount;
+  size_t i, j;
+
+  if ( (count == maxBest) && (score >= inoutBest[count - 1].score) )
+  {
+    return;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    if ( (UINTDIFF(col, inoutBest[i].col) < minDistance)
+         && (UINTDIFF(row, inoutBest[i].row) < minDistance)
+         && (inoutBest[i].score <= score) )
+    {
+      return;
+    }
+  }
+
+  /* remove worse locations that are too close */
+  for (i = j = 0; i < count; ++i)
+  {
+    if ( (UINTDIFF(col, inoutBest[i].col) >= minDistance)
+         || (UINTDIFF(row, inoutBest[i].row) >= minDistance) )
+    {
+      inoutBest[j++] = inoutBest[i];
+    }
+  }
+
+  count = (j < maxBest) ? j + 1 : maxBest;
+
+  /* insertion sort from the back */
+  for (i = count - 1; (i > 0) && (inoutBest[i - 1].score > score); --i)
+  {
+    inoutBest[i] = inoutBest[i - 1];
+  }
+
+  inoutBest[i].col   = col;
+  inoutBest[i].row   = row;
+  inoutBest[i].score = score;
+
+  *inoutCount = count;
+}
+
+
+/*
+ * Template matching score image
+ *
+ * The template is compared with the window at every position where it fits
+ * entirely inside the image. The output score image is (width - template
+ * width + 1) by (height - template height + 1) and its pixel at column and
+ * row is the score of the window with its top left corner there.
+ *
+ * Lower scores are better for all methods. SAD is the sum of absolute
+ * differences and SSD is the sum of squared differences. Both saturate at
+ * the largest 32 bit value. NCC is normalized cross correlation scaled to
+ * 32768 * (1 - correlation), so it is 0 for a perfect match and does not
+ * change with the brightness or contrast of the window.
+ *
+ * The window sums for NCC come from the integral image and the squared
+ * integral image of the input image so only the cross correlation term is
+ * computed for every window. These are not needed for SAD and SSD and may be
+ * null.
+ *
+ * The 64 bit NCC sums limit the template to ECV_MATCH_MAX_PIXELS pixels. Any
+ * larger template has every NCC score set to 65536, no match.
+ *
+ */
+void MatchTemplate (Image32_t            *outScores,
+                    const Image8_t       *inImg,
+                    const Image8_t       *inTemplate,
+                    const Image32_t      *inIntImg,    /* NCC only */
+                    const Image64_t      *inSqIntImg,  /* NCC only */
+                    const EcvMatchMethod  method)
+{
+  const size_t width     = inImg->width;
+  const size_t tplWidth  = inTemplate->width;
+  const size_t tplHeight = inTemplate->height;
+  const size_t numPixels = tplWidth * tplHeight;
+
+  uint32_t *ptrOut = outScores->data;
+
+  uint64_t sumTpl, sumSqTpl, stdTpl, sumImg, sumSqImg, sumCross;
+  size_t   row, col, i, right, bottom;
+
+  const uint8_t *ptrImg, *ptrTpl;
+
+  if (method != ECV_MATCH_NCC)
+  {
+    for (row = 0; row < outScores->height; ++row)
+    {
+      for (col = 0; col < outScores->width; ++col)
+      {
+        *ptrOut++ = MatchScoreAt(inImg, inTemplate, col, row, method, 0, 0);
+      }
+    }
+
+    return;
+  }
+
+  if (numPixels > ECV_MATCH_MAX_PIXELS)
+  {
+    UNROLL_LOOP( outScores->width * outScores->height,
+
+        *ptrOut++ = 65536;
+    )
+
+    return;
+  }
+
+  MatchTemplateSums(&sumTpl, &sumSqTpl, inTemplate);
+  stdTpl = UintSqrt64(numPixels * sumSqTpl - sumTpl * sumTpl);
+
+  for (row = 0; row < outScores->height; ++row)
+  {
+    bottom = (row + tplHeight - 1) * width;
+
+    for (col = 0; col < outScores->width; ++col)
+    {
+      right = col + tplWidth - 1;
+
+      /* window sums from the inclusive integral images */
+      sumImg   = inIntImg->data[bottom + right];
+      sumSqImg = inSqIntImg->data[bottom + right];
+
+      if (row)
+      {
+        sumImg   -= inIntImg->data[(row - 1) * width + right];
+        sumSqImg -= inSqIntImg->data[(row - 1) * width + right];
+      }
+
+      if (col)
+      {
+        sumImg   -= inIntImg->data[bottom + col - 1];
+        sumSqImg -= inSqIntImg->data[bottom + col - 1];
+      }
+
+      if (row && col)
+      {
+        sumImg   += inIntImg->data[(row - 1) * width + col - 1];
+        sumSqImg += inSqIntImg->data[(row - 1) * width + col - 1];
+      }
+
+      /* cross correlation term */
+      sumCross = 0;
+      ptrTpl   = inTemplate->data;
+
+      for (i = 0; i < tplHeight; ++i)
+      {
+        ptrImg = inImg->data + (row + i) * width + col;
+
+        UNROLL_LOOP( tplWidth,
+
+            sumCross += *ptrImg++ * *ptrTpl++;
+        )
+      }
+
+      *ptrOut++ = MatchNCCScore(numPixels, sumImg, sumSqImg, sumTpl, stdTpl,
+                                sumCross);
+    }
+  }
+}
+
+
+/*
+ * Best locations in a template matching score image
+ *
+ * The lowest scores are written to the output array in increasing order.
+ * Locations closer than the minimum distance (in both directions) to a
+ * better location are skipped, so one match does not fill the whole list.
+ * A minimum distance of half the template size is typical. The number of
+ * locations found is returned.
+ *
+ */
+size_t MatchTemplateBest (MatchLocation_t *outBest,
+                          const size_t     maxBest,
+                          const Image32_t *inScores,
+                          const size_t     minDistance)
+{
+  const uint32_t *ptrScore = inScores->data;
+
+  size_t row, col;
+  size_t count = 0;
+
+  if (! maxBest)
+  {
+    return 0;
+  }
+
+  for (row = 0; row < inScores->height; ++row)
+  {
+    for (col = 0; col < inScores->width; ++col)
+    {
+      MatchInsert(outBest, &count, maxBest, col, row, *ptrScore++,
+                  minDistance);
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Coarse to fine template matching over image pyramids
+ *
+ * The image and template pyramids must use the same filter and have their
+ * base images set for the frame. The search starts at the highest level
+ * where the template is still at least 8 pixels on a side, scanning every
+ * position there for the best locations. Each location is then doubled and
+ * refined at every lower level by searching the positions within the
+ * search radius. Only the top level is searched exhaustively so the cost is
+ * a small fraction of MatchTemplate() on the base images.
+ *
+ * The best locations at the base level are written to the output array in
+ * increasing score order, as for MatchTemplateBest(). The minimum distance
+ * is in base image pixels. The number of locations found is returned.
+ * Templates over ECV_MATCH_MAX_PIXELS pixels are not searched with NCC.
+ *
+ */
+size_t MatchTemplatePyramid (MatchLocation_t      *outBest,
+                             const size_t          maxBest,
+                             ImagePyramid_t       *inoutImgPyramid,
+                             ImagePyramid_t       *inoutTplPyramid,
+                             const EcvMatchMethod  method,
+                             const size_t          searchRadius,
+                             const size_t          minDistance)
+{
+  const Image8_t *img, *tpl;
+
+  uint64_t sumTpl = 0, sumSqTpl, stdTpl = 0;
+  uint32_t score;
+  size_t   level, top, row, col, i, count = 0;
+  size_t   rowBegin, rowEnd, colBegin, colEnd, bestRow, bestCol;
+
+  if ( (! maxBest)
+       || ( (method == ECV_MATCH_NCC)
+            && (inoutTplPyramid->levels[0].width
+                * inoutTplPyramid->levels[0].height > ECV_MATCH_MAX_PIXELS) )
+       || (inoutTplPyramid->levels[0].width > inoutImgPyramid->levels[0].width)
+       || (inoutTplPyramid->levels[0].height
+               > inoutImgPyramid->levels[0].height) )
+  {
+    return 0;
+  }
+
+  /* highest level with a big enough template that still fits */
+  for (top = 0;
+       (top + 1 < inoutImgPyramid->numberLevels)
+       && (top + 1 < inoutTplPyramid->numberLevels);
+       ++top)
+  {
+    tpl = inoutTplPyramid->levels + top + 1;
+    img = inoutImgPyramid->levels + top + 1;
+
+    if ( (tpl->width < MATCH_MIN_TEMPLATE)
+         || (tpl->height < MATCH_MIN_TEMPLATE)
+         || (tpl->width > img->width) || (tpl->height > img->height) )
+    {
+      break;
+    }
+  }
+
+  img = ImagePyramidLevel(inoutImgPyramid, top);
+  tpl = ImagePyramidLevel(inoutTplPyramid, top);
+
+  if (method == ECV_MATCH_NCC)
+  {
+    MatchTemplateSums(&sumTpl, &sumSqTpl, tpl);
+    stdTpl = UintSqrt64((uint64_t)tpl->width * tpl->height * sumSqTpl
+                        - sumTpl * sumTpl);
+  }
+
+  /* exhaustive search at the top level */
+  for (row = 0; row + tpl->height <= img->height; ++row)
+  {
+    for (col = 0; col + tpl->width <= img->width; ++col)
+    {
+      score = MatchScoreAt(img, tpl, col, row, method, sumTpl, stdTpl);
+
+      MatchInsert(outBest, &count, maxBest, col, row, score,
+                  (minDistance >> top) + 1);
+    }
+  }
+
+  /* refine every location down the levels */
+  for (level = top; level-- > 0; )
+  {
+    img = ImagePyramidLevel(inoutImgPyramid, level);
+    tpl = ImagePyramidLevel(inoutTplPyramid, level);
+
+    if (method == ECV_MATCH_NCC)
+    {
+      MatchTemplateSums(&sumTpl, &sumSqTpl, tpl);
+      stdTpl = UintSqrt64((uint64_t)tpl->width * tpl->height * sumSqTpl
+                          - sumTpl * sumTpl);
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+      row = outBest[i].row << 1;
+      col = outBest[i].col << 1;
+
+      rowBegin = (row > searchRadius) ? row - searchRadius : 0;
+      colBegin = (col > searchRadius) ? col - searchRadius : 0;
+      rowEnd   = row + searchRadius + 1;
+      colEnd   = col + searchRadius + 1;
+
+      if (rowEnd + tpl->height > img->height + 1)
+      {
+        rowEnd = img->height + 1 - tpl->height;
+      }
+
+      if (colEnd + tpl->width > img->width + 1)
+      {
+        colEnd = img->width + 1 - tpl->width;
+      }
+
+      /* the template may grow by a pixel more than the image per level */
+      if (rowBegin >= rowEnd)
+      {
+        rowBegin = rowEnd - 1;
+      }
+
+      if (colBegin >= colEnd)
+      {
+        colBegin = colEnd - 1;
+      }
+
+      bestRow = rowBegin;
+      bestCol = colBegin;
+      outBest[i].score = UINT32_MAX;
+
+      for (row = rowBegin; row < rowEnd; ++row)
+      {
+        for (col = colBegin; col < colEnd; ++col)
+        {
+          score = MatchScoreAt(img, tpl, col, row, method, sumTpl, stdTpl);
+
+          if (score < outBest[i].score)
+          {
+            outBest[i].score = score;
+            bestRow = row;
+            bestCol = col;
+          }
+        }
+      }
+
+      outBest[i].row = bestRow;
+      outBest[i].col = bestCol;
+    }
+  }
+
+  /*
+   * Locations refined independently may have moved closer than the minimum
+   * distance and their scores changed. So they go through the same sorted
+   * insertion with suppression as MatchTemplateBest() again.
+   */
+  const size_t numRefined = count;
+
+  MatchLocation_t refined[numRefined];
+
+  memcpy(refined, outBest, sizeof(MatchLocation_t) * numRefined);
+
+  count = 0;
+
+  for (i = 0; i < numRefined; ++i)
+  {
+    MatchInsert(outBest, &count, maxBest, refined[i].col, refined[i].row,
+                refined[i].score, minDistance);
+  }
+
+  return count;
+}
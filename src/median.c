@@ -0,0 +1,277 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/*
+ * Update a range of the window histogram by adding and removing columns
+ *
+ */
+static void AddColumnRange (uint32_t       *inoutHist,
+                            const uint16_t *inColumns,  /* first column */
+                            const size_t    numColumns,
+                            const size_t    numBins,
+                            const size_t    stride,     /* between columns */
+                            const int       subtract)
+{
+  const uint16_t *ptrColumn;
+  size_t          i;
+
+  for (ptrColumn = inColumns;
+       ptrColumn != inColumns + numColumns * stride;
+       ptrColumn += stride)
+  {
+    if (subtract)
+    {
+      for (i = 0; i < numBins; ++i)
+      {
+        inoutHist[i] -= ptrColumn[i];
+      }
+    }
+    else
+    {
+      for (i = 0; i < numBins; ++i)
+      {
+        inoutHist[i] += ptrColumn[i];
+      }
+    }
+  }
+}
+
+
+/*
+ * Percentile (rank) filter over a square window with constant time per pixel
+ *
+ * Every output pixel is the given percentile of the input pixels in the
+ * square window of the given radius around it. Percentile 0 is the minimum,
+ * 50 is the median and 100 is the maximum. Larger percentiles are taken as
+ * 100. The window is clipped at the image borders.
+ *
+ * Algorithm is from the paper:
+ *
+ * Median Filtering in Constant Time
+ * by Simon Perreault and Patrick Hebert
+ * IEEE Transactions on Image Processing, 2007
+ *
+ * There is a histogram for every column of the image covering the rows of
+ * the window. Moving down a row adds one pixel to and removes one pixel from
+ * each column histogram. Moving right along a row adds one column histogram
+ * to and removes one from the window histogram. Neither depends on the
+ * radius.
+ *
+ * The histograms have two levels, 16 coarse bins of the high four bits and
+ * 256 fine bins. Only the coarse window histogram is updated at every pixel.
+ * The fine window histogram is kept in 16 segments. A segment is brought up
+ * to date only when the percentile falls in its coarse bin, by adding and
+ * removing the columns that entered and left since it was last used.
+ *
+ * The temporary storage needs 272 * width elements. The image height must be
+ * less than 65536.
+ *
+ */
+void PercentileFilterImage (Image8_t       *outImg,
+                            uint16_t       *tmpColumns,
+                            const Image8_t *inImg,
+                            const size_t    radius,
+                            const size_t    percentile)
+{
+  const size_t width  = inImg->width;
+  const size_t height = inImg->height;
+  const size_t rank   = (percentile < 100) ? percentile : 100;
+
+  /* column histograms, 16 coarse bins then 256 fine bins each */
+  const size_t stride = 16 + 256;
+
+  uint32_t coarse[16];
+  uint32_t fine[256];
+
+  /* window columns each fine segment was last brought up to date for */
+  size_t segFirst[16], segLast[16];
+
+  const uint8_t *ptrIn;
+  uint8_t       *ptrOut = outImg->data;
+  uint16_t      *ptrColumn;
+
+  size_t row, col, rowFirst, rowLast, colFirst, colLast, i, k;
+  size_t count, target, accum;
+
+  memset(tmpColumns, 0, sizeof(uint16_t) * stride * width);
+
+  /* column histograms for the rows of the first window */
+  rowLast = (radius < height) ? radius : height - 1;
+  ptrIn   = inImg->data;
+
+  for (row = 0; row <= rowLast; ++row)
+  {
+    ptrColumn = tmpColumns;
+
+    UNROLL_LOOP( width,
+
+        ptrColumn[ *ptrIn >> 4 ]++;
+        ptrColumn[ 16 + *ptrIn ]++;
+        ptrIn++;
+        ptrColumn += stride;
+    )
+  }
+
+  for (row = 0; row < height; ++row)
+  {
+    rowFirst = (row > radius) ? row - radius : 0;
+    rowLast  = (row + radius < height) ? row + radius : height - 1;
+
+    /* move the column histograms down one row */
+    if (row)
+    {
+      if (row > radius)
+      {
+        ptrIn     = inImg->data + (row - radius - 1) * width;
+        ptrColumn = tmpColumns;
+
+        UNROLL_LOOP( width,
+
+            ptrColumn[ *ptrIn >> 4 ]--;
+            ptrColumn[ 16 + *ptrIn ]--;
+            ptrIn++;
+            ptrColumn += stride;
+        )
+      }
+
+      if (row + radius < height)
+      {
+        ptrIn     = inImg->data + (row + radius) * width;
+        ptrColumn = tmpColumns;
+
+        UNROLL_LOOP( width,
+
+            ptrColumn[ *ptrIn >> 4 ]++;
+            ptrColumn[ 16 + *ptrIn ]++;
+            ptrIn++;
+            ptrColumn += stride;
+        )
+      }
+    }
+
+    /* coarse window histogram for the first pixel, fine segments empty */
+    colLast = (radius < width) ? radius : width - 1;
+
+    memset(coarse, 0, sizeof(coarse));
+    AddColumnRange(coarse, tmpColumns, colLast + 1, 16, stride, 0);
+
+    memset(fine, 0, sizeof(fine));
+    for (k = 0; k < 16; ++k)
+    {
+      segFirst[k] = 0;
+      segLast[k]  = 0;  /* empty, no columns added yet */
+    }
+
+    for (col = 0; col < width; ++col)
+    {
+      colFirst = (col > radius) ? col - radius : 0;
+      colLast  = (col + radius < width) ? col + radius : width - 1;
+
+      /* slide the coarse window histogram right */
+      if (col)
+      {
+        if (col > radius)
+        {
+          AddColumnRange(coarse, tmpColumns + (col - radius - 1) * stride,
+                         1, 16, stride, 1);
+        }
+
+        if (col + radius < width)
+        {
+          AddColumnRange(coarse, tmpColumns + colLast * stride,
+                         1, 16, stride, 0);
+        }
+      }
+
+      count  = (rowLast - rowFirst + 1) * (colLast - colFirst + 1);
+      target = ((count - 1) * rank) / 100;
+
+      /* coarse bin containing the percentile */
+      accum = 0;
+      for (k = 0; accum + coarse[k] <= target; ++k)
+      {
+        accum += coarse[k];
+      }
+
+      /* bring the fine segment up to date, windows only move right */
+      ptrColumn = tmpColumns + 16 + (k << 4);
+
+      if (segLast[k] <= colFirst)
+      {
+        /* no overlap with the last window, start again */
+        memset(fine + (k << 4), 0, sizeof(uint32_t) * 16);
+        AddColumnRange(fine + (k << 4), ptrColumn + colFirst * stride,
+                       colLast - colFirst + 1, 16, stride, 0);
+      }
+      else
+      {
+        AddColumnRange(fine + (k << 4), ptrColumn + segFirst[k] * stride,
+                       colFirst - segFirst[k], 16, stride, 1);
+        AddColumnRange(fine + (k << 4), ptrColumn + segLast[k] * stride,
+                       colLast + 1 - segLast[k], 16, stride, 0);
+      }
+
+      segFirst[k] = colFirst;
+      segLast[k]  = colLast + 1;  /* one past the last column */
+
+      /* fine bin containing the percentile */
+      i = k << 4;
+      while (accum + fine[i] <= target)
+      {
+        accum += fine[i++];
+      }
+
+      *ptrOut++ = i;
+    }
+  }
+}
+
+
+/*
+ * Median filter over a square window with constant time per pixel
+ *
+ * Salt and pepper noise is removed while edges are preserved. This is the
+ * 50th percentile from PercentileFilterImage() so the cost per pixel does
+ * not depend on the radius. The temporary storage needs 272 * width
+ * elements.
+ *
+ */
+void MedianFilterImage (Image8_t       *outImg,
+                        uint16_t       *tmpColumns,
+                        const Image8_t *inImg,
+                        const size_t    radius)
+{
+  PercentileFilterImage(outImg, tmpColumns, inImg, radius, 50);
+}
@@ -0,0 +1,235 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/* large diamond and hexagon search patterns, then the small diamond */
+static const int8_t largeDiamond[8][2] = { { 2, 0 }, { 1, 1 }, { 0, 2 },
+                                           { -1, 1 }, { -2, 0 }, { -1, -1 },
+                                           { 0, -2 }, { 1, -1 } };
+
+static const int8_t largeHexagon[6][2] = { { 2, 0 }, { 1, 2 }, { -1, 2 },
+                                           { -2, 0 }, { -1, -2 }, { 1, -2 } };
+
+static const int8_t smallDiamond[4][2] = { { 1, 0 }, { 0, 1 },
+                                           { -1, 0 }, { 0, -1 } };
+
+
+/*
+ * Sum of absolute differences between a block and a displaced block
+ *
+ */
+static uint32_t MotionBlockSAD (const Image8_t *inPrevImg,
+                                const Image8_t *inCurrImg,
+                                const size_t    col,
+                                const size_t    row,
+                                const size_t    blockSize,
+                                const int       dx,
+                                const int       dy)
+{
+  const size_t width = inCurrImg->width;
+
+  const uint8_t *ptrCurr = inCurrImg->data + row * width + col;
+  const uint8_t *ptrPrev = inPrevImg->data + (row + dy) * width + col + dx;
+
+  uint32_t sad = 0;
+
+  NORMAL_LOOP( blockSize,
+
+      UNROLL_LOOP( blockSize,
+
+          sad += UINTDIFF(*ptrCurr, *ptrPrev);
+          ptrCurr++;
+          ptrPrev++;
+      )
+
+      ptrCurr += width - blockSize;
+      ptrPrev += width - blockSize;
+  )
+
+  return sad;
+}
+
+
+/*
+ * Try a candidate displacement and keep it if it is better
+ *
+ * Displacements outside the search range or moving the block off the image
+ * are not allowed. Returns 1 if the candidate is better.
+ *
+ */
+static int MotionTry (int            *inoutDx,
+                      int            *inoutDy,
+                      uint32_t       *inoutCost,
+                      const Image8_t *inPrevImg,
+                      const Image8_t *inCurrImg,
+                      const size_t    col,
+                      const size_t    row,
+                      const size_t    blockSize,
+                      const int       range,
+                      const int       dx,
+                      const int       dy)
+{
+  uint32_t cost;
+
+  if ( (dx < -range) || (dx > range) || (dy < -range) || (dy > range)
+       || ((int)col + dx < 0) || ((int)row + dy < 0)
+       || (col + dx + blockSize > inCurrImg->width)
+       || (row + dy + blockSize > inCurrImg->height) )
+  {
+    return 0;
+  }
+
+  cost = MotionBlockSAD(inPrevImg, inCurrImg, col, row, blockSize, dx, dy);
+
+  if (cost < *inoutCost)
+  {
+    *inoutCost = cost;
+    *inoutDx   = dx;
+    *inoutDy   = dy;
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * Block matching motion estimation
+ *
+ * The current image is broken into square blocks of 2^blockShift pixels on
+ * a side, typically 8x8 or 16x16. Partial blocks at the right and bottom
+ * edges are skipped. For every block, the motion vector is the displacement
+ * to the block of the previous image with the smallest sum of absolute
+ * differences. So the block content came from the previous image at the
+ * block position plus the motion vector.
+ *
+ * Full search is too slow so this is a pattern search. The starting point is
+ * the best of zero motion and the vectors of the blocks to the left and
+ * above, as neighboring blocks usually move together. The large diamond or
+ * large hexagon pattern is moved to its best point until the center is
+ * best. A final small diamond step refines the vector. Vectors are limited
+ * to the search range in both directions.
+ *
+ * The motion vector field and the cost map have one element for every block
+ * in row order. The cost map is optional and holds the sum of absolute
+ * differences of the chosen vector, which fits in 16 bits for blocks up to
+ * 16x16.
+ *
+ */
+void MotionEstimate (MotionVector_t         *outVectors,
+                     Image16_t              *outCost,     /* may be null */
+                     const Image8_t         *inPrevImg,
+                     const Image8_t         *inCurrImg,
+                     const size_t            blockShift,
+                     const size_t            searchRange,
+                     const EcvMotionSearch   search)
+{
+  const size_t blockSize  = (size_t)1 << blockShift;
+  const size_t numCols    = inCurrImg->width >> blockShift;
+  const size_t numRows    = inCurrImg->height >> blockShift;
+  const int    range      = searchRange;
+
+  const int8_t (*pattern)[2] = (search == ECV_MOTION_HEXAGON)
+                                   ? largeHexagon : largeDiamond;
+  const size_t numPattern    = (search == ECV_MOTION_HEXAGON) ? 6 : 8;
+
+  MotionVector_t *ptrVector = outVectors;
+  uint16_t       *ptrCost   = outCost ? outCost->data : 0;
+
+  size_t   blockRow, blockCol, col, row, i;
+  int      dx, dy, centerDx, centerDy;
+  uint32_t cost;
+
+  for (blockRow = 0; blockRow < numRows; ++blockRow)
+  {
+    row = blockRow << blockShift;
+
+    for (blockCol = 0; blockCol < numCols; ++blockCol)
+    {
+      col = blockCol << blockShift;
+
+      /* zero motion and the neighboring vectors as starting points */
+      dx   = dy = 0;
+      cost = MotionBlockSAD(inPrevImg, inCurrImg, col, row, blockSize, 0, 0);
+
+      if (blockCol)
+      {
+        MotionTry(&dx, &dy, &cost, inPrevImg, inCurrImg, col, row, blockSize,
+                  range, ptrVector[-1].col, ptrVector[-1].row);
+      }
+
+      if (blockRow)
+      {
+        MotionTry(&dx, &dy, &cost, inPrevImg, inCurrImg, col, row, blockSize,
+                  range, ptrVector[-(ptrdiff_t)numCols].col,
+                  ptrVector[-(ptrdiff_t)numCols].row);
+      }
+
+      /* large pattern until the center is best */
+      do
+      {
+        centerDx = dx;
+        centerDy = dy;
+
+        for (i = 0; i < numPattern; ++i)
+        {
+          MotionTry(&dx, &dy, &cost, inPrevImg, inCurrImg, col, row,
+                    blockSize, range,
+                    centerDx + pattern[i][0], centerDy + pattern[i][1]);
+        }
+      }
+      while ( (dx != centerDx) || (dy != centerDy) );
+
+      /* small diamond refinement */
+      centerDx = dx;
+      centerDy = dy;
+
+      for (i = 0; i < 4; ++i)
+      {
+        MotionTry(&dx, &dy, &cost, inPrevImg, inCurrImg, col, row,
+                  blockSize, range,
+                  centerDx + smallDiamond[i][0], centerDy + smallDiamond[i][1]);
+      }
+
+      ptrVector->col = dx;
+      ptrVector->row = dy;
+      ptrVector++;
+
+      if (ptrCost)
+      {
+        *ptrCost++ = (cost > 0xffff) ? 0xffff : cost;
+      }
+    }
+  }
+}
@@ -64,7 +64,8 @@ void SobelEdges (Image16_t      *outImgX,
 
   size_t i, j;
 
-  uint8_t value, twiceValue;
+  uint8_t  value;
+  uint16_t twiceValue;  /* twice a pixel value needs nine bits */
 
   const uint8_t *ptrIn         = inImg->data + width + 1;
   int16_t       *ptrUpLeftX    = outDataX;
@@ -88,10 +89,10 @@ void SobelEdges (Image16_t      *outImgX,
           twiceValue = value << 1;
 
           /* horizontal edges */
-          *ptrUpLeftX    += value;
-          *ptrUpRightX   -= value;
-          *ptrDownLeftX  += value;
-          *ptrDownRightX -= value;
+          *ptrUpLeftX++    += value;
+          *ptrUpRightX++   -= value;
+          *ptrDownLeftX++  += value;
+          *ptrDownRightX++ -= value;
 
           *ptrLeftX++      += twiceValue;
           *ptrRightX++     -= twiceValue;
@@ -127,6 +128,111 @@ void SobelEdges (Image16_t      *outImgX,
 }
 
 
+/*
+ * Sobel edge detection limited to the changed blocks of a change map
+ *
+ * Output pixels in the changed blocks are computed exactly as by
+ * SobelEdges(). All other output pixels are left alone so the output images
+ * should hold the edges of an earlier frame. Pixels near the border of a
+ * changed block depend on pixels in the neighboring blocks so the change map
+ * should be dilated with ChangeMapDilate() first.
+ *
+ * SobelEdges() scatters every interior input pixel to its neighbors. Here
+ * every output pixel gathers from its neighbors instead, only counting the
+ * interior input pixels, which gives the same result.
+ *
+ */
+void SobelEdgesMasked (Image16_t      *outImgX,
+                       Image16_t      *outImgY,
+                       const Image8_t *inImg,
+                       const Image8_t *inChangeMap)
+{
+  const size_t height = inImg->height;
+  const size_t width  = inImg->width;
+
+  const uint8_t *ptrMap = inChangeMap->data;
+
+  const uint8_t *ptrUp, *ptrMid, *ptrDown;
+
+  size_t  mapRow, mapCol, row, col, rowEnd, colEnd, qRow, qCol;
+  int16_t gradX, gradY, value;
+  int     dRow, dCol;
+
+  for (mapRow = 0; mapRow < inChangeMap->height; ++mapRow)
+  {
+    for (mapCol = 0; mapCol < inChangeMap->width; ++mapCol)
+    {
+      if (! *ptrMap++)
+      {
+        continue;
+      }
+
+      rowEnd = (mapRow + 1) * CHANGEMAP_BLOCK;
+      colEnd = (mapCol + 1) * CHANGEMAP_BLOCK;
+
+      if (rowEnd > height)
+      {
+        rowEnd = height;
+      }
+
+      if (colEnd > width)
+      {
+        colEnd = width;
+      }
+
+      for (row = mapRow * CHANGEMAP_BLOCK; row < rowEnd; ++row)
+      {
+        ptrMid = inImg->data + row * width;
+
+        for (col = mapCol * CHANGEMAP_BLOCK; col < colEnd; ++col)
+        {
+          if ( (row > 1) && (row + 2 < height)
+               && (col > 1) && (col + 2 < width) )
+          {
+            /* all neighbors are interior pixels */
+            ptrUp   = ptrMid - width + col;
+            ptrDown = ptrMid + width + col;
+
+            gradX = (ptrUp[1] + (ptrMid[col + 1] << 1) + ptrDown[1])
+                    - (ptrUp[-1] + (ptrMid[col - 1] << 1) + ptrDown[-1]);
+
+            gradY = (ptrDown[-1] + (ptrDown[0] << 1) + ptrDown[1])
+                    - (ptrUp[-1] + (ptrUp[0] << 1) + ptrUp[1]);
+          }
+          else
+          {
+            /* near the image border, pixels on the border do not count */
+            gradX = gradY = 0;
+
+            for (dRow = -1; dRow <= 1; ++dRow)
+            {
+              for (dCol = -1; dCol <= 1; ++dCol)
+              {
+                qRow = row + dRow;
+                qCol = col + dCol;
+
+                /* unsigned so wrap around below zero is caught too */
+                if ( (qRow - 1 >= height - 2) || (qCol - 1 >= width - 2) )
+                {
+                  continue;
+                }
+
+                value  = inImg->data[qRow * width + qCol];
+                gradX += dCol * (dRow ? value : value << 1);
+                gradY += dRow * (dCol ? value : value << 1);
+              }
+            }
+          }
+
+          outImgX->data[row * width + col] = gradX;
+          outImgY->data[row * width + col] = gradY;
+        }
+      }
+    }
+  }
+}
+
+
 /*
  * The one norm - sum of absolute values - of the X and Y component edge images
  *
@@ -199,6 +305,172 @@ void EdgeImagesToSS (Image8_t        *outImg,
 }
 
 
+/*
+ * Canny edge detection from the Sobel edge images
+ *
+ * The gradient magnitude is the one norm, as in EdgeImagesTo1Norm(). An edge
+ * pixel must have a magnitude that is a local maximum across the edge. The
+ * gradient orientation from ApproxAtan2() is rounded to one of four
+ * directions (horizontal, vertical and the two diagonals) and the magnitude
+ * is compared with the two neighbors along that direction. This thins the
+ * edges to one pixel wide.
+ *
+ * There are two thresholds. Local maxima with a magnitude at or above the
+ * high threshold are strong edges. Those at or above the low threshold are
+ * weak edges which are kept only if they are connected to a strong edge
+ * through other weak edges. The strong edges are pushed on a stack as they
+ * are found. Popping the stack and pushing every weak neighbor turns it into
+ * a strong edge, so the hysteresis is one flood fill instead of repeated
+ * passes over the image.
+ *
+ * Edge pixels are set to the mark value and all others to zero. The pixels
+ * on the image border are never edges. The temporary stack needs one
+ * element for every pixel. The number of edge pixels is returned.
+ *
+ */
+size_t CannyEdges (Image8_t        *outImg,
+                   uint32_t        *tmpStack,
+                   const Image16_t *inImgEdgeX,
+                   const Image16_t *inImgEdgeY,
+                   const size_t     lowThreshold,
+                   const size_t     highThreshold,
+                   const uint8_t    mark)
+{
+  const size_t width  = outImg->width;
+  const size_t height = outImg->height;
+
+  /* neighbor offsets across the edge for the four gradient directions */
+  const ptrdiff_t across[4] = { 1, width + 1, width, width - 1 };
+
+  /* magnitudes of three rows, the row being thinned is in the middle */
+  uint16_t magnitude[3 * width];
+
+  uint16_t *magUp   = magnitude;
+  uint16_t *magMid  = magnitude + width;
+  uint16_t *magDown = magnitude + (width << 1);
+  uint16_t *swapTmp;
+
+  const int16_t *ptrInX = (const int16_t *) inImgEdgeX->data;
+  const int16_t *ptrInY = (const int16_t *) inImgEdgeY->data;
+
+  uint8_t  *ptrOut = outImg->data;
+  uint32_t *ptrTop = tmpStack;
+
+  size_t    row, col, idx, value, direction, k;
+  ptrdiff_t offset;
+  size_t    count = 0;
+
+  /* candidates are 1 for weak edges and 2 for strong edges until the end */
+  memset(ptrOut, 0, sizeof(uint8_t) * width * height);
+
+  if ( (width < 3) || (height < 3) )
+  {
+    return 0;
+  }
+
+  for (row = 0; row < 2; ++row)
+  {
+    for (col = 0; col < width; ++col)
+    {
+      magnitude[row * width + col] = abs(*ptrInX++) + abs(*ptrInY++);
+    }
+  }
+
+  for (row = 1; row + 1 < height; ++row)
+  {
+    for (col = 0; col < width; ++col)
+    {
+      magDown[col] = abs(*ptrInX++) + abs(*ptrInY++);
+    }
+
+    for (col = 1; col + 1 < width; ++col)
+    {
+      value = magMid[col];
+
+      if (value < lowThreshold)
+      {
+        continue;
+      }
+
+      /*
+       * orientation index 0 to 127 rounded to four directions, opposite
+       * octants share a direction
+       */
+      idx       = row * width + col;
+      direction = ( ( ApproxAtan2(inImgEdgeY->data[idx],
+                                  inImgEdgeX->data[idx]) + 8 ) >> 4 ) & 0x3;
+      offset    = across[direction];
+
+      /* neighbors across the edge, one in the row above or the same row */
+      if (direction)
+      {
+        if ( (value <= magUp[col + width - offset])
+             || (value < magDown[col + offset - width]) )
+        {
+          continue;
+        }
+      }
+      else if ( (value <= magMid[col - 1]) || (value < magMid[col + 1]) )
+      {
+        continue;
+      }
+
+      if (value >= highThreshold)
+      {
+        ptrOut[idx] = 2;
+        *ptrTop++   = idx;
+      }
+      else
+      {
+        ptrOut[idx] = 1;
+      }
+    }
+
+    swapTmp = magUp;
+    magUp   = magMid;
+    magMid  = magDown;
+    magDown = swapTmp;
+  }
+
+  /* hysteresis, weak edges next to strong edges become strong */
+  const ptrdiff_t neighbor[8] = { -(ptrdiff_t)width - 1, -(ptrdiff_t)width,
+                                  -(ptrdiff_t)width + 1, -1, 1,
+                                  width - 1, width, width + 1 };
+
+  while (ptrTop != tmpStack)
+  {
+    idx = *--ptrTop;
+
+    for (k = 0; k < 8; ++k)
+    {
+      if (ptrOut[idx + neighbor[k]] == 1)
+      {
+        ptrOut[idx + neighbor[k]] = 2;
+        *ptrTop++ = idx + neighbor[k];
+      }
+    }
+  }
+
+  /* strong edges are marked and everything else is cleared */
+  UNROLL_LOOP( width * height,
+
+      if (*ptrOut == 2)
+      {
+        *ptrOut = mark;
+        count++;
+      }
+      else
+      {
+        *ptrOut = 0;
+      }
+
+      ptrOut++;
+  )
+
+  return count;
+}
+
+
 /*
  * Morphological erosion with a structuring element 3 pixels across and 1 down
  *
@@ -902,6 +1174,191 @@ void RegionDilate55 (Image8_t *inoutImg, const uint8_t mark)
 }
 
 
+/*
+ * Square structuring element morphology limited to the changed blocks
+ *
+ * A snapshot of the original pixels of each row of blocks and the rows
+ * around it is taken before the row of blocks is changed. So marked pixels
+ * never affect their neighbors, as in the unmasked operations.
+ *
+ */
+static void RegionMaskedSquare (Image8_t       *inoutImg,
+                                const Image8_t *inChangeMap,
+                                const size_t    radius,
+                                const int       dilate,
+                                const uint8_t   mark)
+{
+  const size_t width   = inoutImg->width;
+  const size_t height  = inoutImg->height;
+  const size_t bufRows = CHANGEMAP_BLOCK + (radius << 1);
+
+  /* original pixels from radius rows above to radius rows below the blocks */
+  uint8_t snapshot[bufRows * width];
+
+  const uint8_t *ptrMap = inChangeMap->data;
+  const uint8_t *ptrSnap, *ptrWindow;
+
+  size_t mapRow, mapCol, row, col, rowBegin, rowEnd, colBegin, colEnd;
+  size_t firstRow, prevFirstRow = 0, numRows, kept, i, j;
+  int    prevSnapshot = 0;
+  int    active, found;
+
+  for (mapRow = 0; mapRow < inChangeMap->height; ++mapRow)
+  {
+    /* any changed blocks in this row of blocks */
+    active = 0;
+    for (mapCol = 0; mapCol < inChangeMap->width; ++mapCol)
+    {
+      active |= ptrMap[mapCol];
+    }
+
+    if (! active)
+    {
+      ptrMap += inChangeMap->width;
+      prevSnapshot = 0;
+      continue;
+    }
+
+    /* snapshot, rows above were changed by the previous row of blocks */
+    rowBegin = mapRow * CHANGEMAP_BLOCK;
+    rowEnd   = (rowBegin + CHANGEMAP_BLOCK < height)
+                   ? rowBegin + CHANGEMAP_BLOCK : height;
+
+    firstRow = (rowBegin > radius) ? rowBegin - radius : 0;
+    numRows  = ((rowEnd + radius < height) ? rowEnd + radius : height)
+               - firstRow;
+
+    kept = prevSnapshot ? (radius << 1) : 0;
+
+    if (kept > numRows)
+    {
+      kept = numRows;
+    }
+
+    memmove(snapshot,
+            snapshot + (firstRow - prevFirstRow) * width,
+            sizeof(uint8_t) * kept * width);
+
+    memcpy(snapshot + kept * width,
+           inoutImg->data + (firstRow + kept) * width,
+           sizeof(uint8_t) * (numRows - kept) * width);
+
+    prevSnapshot = 1;
+    prevFirstRow = firstRow;
+
+    /* pixels with the whole window inside the image */
+    if (rowBegin < radius)
+    {
+      rowBegin = radius;
+    }
+
+    if (rowEnd + radius > height)
+    {
+      rowEnd = (height > radius) ? height - radius : 0;
+    }
+
+    for (mapCol = 0; mapCol < inChangeMap->width; ++mapCol)
+    {
+      if (! *ptrMap++)
+      {
+        continue;
+      }
+
+      colBegin = mapCol * CHANGEMAP_BLOCK;
+      colEnd   = colBegin + CHANGEMAP_BLOCK;
+
+      if (colBegin < radius)
+      {
+        colBegin = radius;
+      }
+
+      if (colEnd + radius > width)
+      {
+        colEnd = (width > radius) ? width - radius : 0;
+      }
+
+      for (row = rowBegin; row < rowEnd; ++row)
+      {
+        ptrSnap = snapshot + (row - firstRow) * width;
+
+        for (col = colBegin; col < colEnd; ++col)
+        {
+          /* erosion changes set pixels, dilation changes clear pixels */
+          if ( (ptrSnap[col] != 0) == (dilate != 0) )
+          {
+            continue;
+          }
+
+          found     = 0;
+          ptrWindow = ptrSnap - radius * width + col - radius;
+
+          for (i = 0; (i <= (radius << 1)) && (! found); ++i)
+          {
+            for (j = 0; j <= (radius << 1); ++j)
+            {
+              if ( (ptrWindow[j] != 0) == (dilate != 0) )
+              {
+                found = 1;
+                break;
+              }
+            }
+
+            ptrWindow += width;
+          }
+
+          if (found)
+          {
+            inoutImg->data[row * width + col] = mark;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+/*
+ * Morphological erosion and dilation limited to the changed blocks
+ *
+ * These are the same as the unmasked operations within the changed blocks
+ * of a change map. Pixels in other blocks and pixels closer than the window
+ * radius to the image border are not changed. Pixels near the border of a
+ * changed block depend on the neighboring blocks so the change map should be
+ * dilated with ChangeMapDilate() first.
+ *
+ */
+void RegionErode33Masked (Image8_t       *inoutImg,
+                          const Image8_t *inChangeMap,
+                          const uint8_t   mark)
+{
+  RegionMaskedSquare(inoutImg, inChangeMap, 1, 0, mark);
+}
+
+
+void RegionErode55Masked (Image8_t       *inoutImg,
+                          const Image8_t *inChangeMap,
+                          const uint8_t   mark)
+{
+  RegionMaskedSquare(inoutImg, inChangeMap, 2, 0, mark);
+}
+
+
+void RegionDilate33Masked (Image8_t       *inoutImg,
+                           const Image8_t *inChangeMap,
+                           const uint8_t   mark)
+{
+  RegionMaskedSquare(inoutImg, inChangeMap, 1, 1, mark);
+}
+
+
+void RegionDilate55Masked (Image8_t       *inoutImg,
+                           const Image8_t *inChangeMap,
+                           const uint8_t   mark)
+{
+  RegionMaskedSquare(inoutImg, inChangeMap, 2, 1, mark);
+}
+
+
 /*
  * If the images are denoted by
  *
@@ -957,6 +1414,137 @@ void DiffImages (Image8_t       *outImg,
 }
 
 
+/*
+ * Find the blocks that changed between two images
+ *
+ * The images are broken into square blocks CHANGEMAP_BLOCK pixels on a side.
+ * The sum of absolute differences over every block is compared with the
+ * threshold. Blocks with a larger sum are set to 1 in the change map and all
+ * other blocks are set to 0. Partial blocks at the right and bottom edges
+ * are included. The number of changed blocks is returned.
+ *
+ * The change map has one pixel for every block. The masked variants of the
+ * image operations only process the changed blocks and leave the rest of
+ * their output alone.
+ *
+ */
+size_t ChangeMap (Image8_t       *outMap,
+                  const Image8_t *inPrevImg,
+                  const Image8_t *inCurrImg,
+                  const size_t    threshold)
+{
+  const size_t width    = inCurrImg->width;
+  const size_t height   = inCurrImg->height;
+  const size_t mapWidth = outMap->width;
+
+  const uint8_t *ptrPrev = inPrevImg->data;
+  const uint8_t *ptrCurr = inCurrImg->data;
+  uint8_t       *ptrMap  = outMap->data;
+
+  uint32_t blockSum[mapWidth];
+
+  size_t row, col, blockCol, colEnd;
+  size_t count = 0;
+
+  uint32_t accum;
+
+  for (row = 0; row < height; ++row)
+  {
+    if ( ! (row & (CHANGEMAP_BLOCK - 1)) )
+    {
+      memset(blockSum, 0, sizeof(uint32_t) * mapWidth);
+    }
+
+    /* sum of absolute differences of the row within each block */
+    for (blockCol = 0, col = 0; col < width; ++blockCol)
+    {
+      colEnd = (col + CHANGEMAP_BLOCK < width) ? col + CHANGEMAP_BLOCK : width;
+      accum  = 0;
+
+      NORMAL_LOOP( colEnd - col,
+
+          accum += UINTDIFF(*ptrPrev, *ptrCurr);
+          ptrPrev++;
+          ptrCurr++;
+      )
+
+      blockSum[blockCol] += accum;
+      col = colEnd;
+    }
+
+    /* last row of a row of blocks */
+    if ( ((row & (CHANGEMAP_BLOCK - 1)) == CHANGEMAP_BLOCK - 1)
+         || (row == height - 1) )
+    {
+      for (blockCol = 0; blockCol < mapWidth; ++blockCol)
+      {
+        count += *ptrMap++ = (blockSum[blockCol] > threshold);
+      }
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Grow the changed blocks of a change map by one block in every direction
+ *
+ * Operations with a neighborhood, like edge detection and morphology, change
+ * output pixels near the border of a changed block in the unchanged blocks
+ * around it. Dilating the change map before a masked operation makes the
+ * result identical to processing the whole image (apart from the image
+ * border conventions of the masked operation). The number of changed blocks
+ * after dilation is returned.
+ *
+ */
+size_t ChangeMapDilate (Image8_t *inoutMap)
+{
+  const size_t width  = inoutMap->width;
+  const size_t height = inoutMap->height;
+
+  uint8_t rowAbove[width], rowCurrent[width];
+  uint8_t *ptrMap = inoutMap->data;
+
+  size_t row, col;
+  size_t count = 0;
+
+  memset(rowAbove, 0, sizeof(uint8_t) * width);
+
+  for (row = 0; row < height; ++row)
+  {
+    /* horizontal dilation of this row */
+    for (col = 0; col < width; ++col)
+    {
+      rowCurrent[col] = ptrMap[col]
+                        || ( col && ptrMap[col - 1] )
+                        || ( (col + 1 < width) && ptrMap[col + 1] );
+    }
+
+    /* vertical dilation with the rows above and below */
+    for (col = 0; col < width; ++col)
+    {
+      ptrMap[col] = rowCurrent[col] || rowAbove[col];
+
+      if (row + 1 < height)
+      {
+        ptrMap[col] = ptrMap[col]
+                      || ptrMap[col + width]
+                      || ( col && ptrMap[col + width - 1] )
+                      || ( (col + 1 < width) && ptrMap[col + width + 1] );
+      }
+
+      count += ptrMap[col];
+    }
+
+    memcpy(rowAbove, rowCurrent, sizeof(uint8_t) * width);
+    ptrMap += width;
+  }
+
+  return count;
+}
+
+
 /*
  * Blur an image using a 3x3 box window average
  *
@@ -0,0 +1,326 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/*
+ * Grid cell containing a point, points off the grid go in the nearest cell
+ *
+ */
+static size_t PointGridCell (const PointGrid_t *inGrid,
+                             const size_t       col,
+                             const size_t       row)
+{
+  size_t cellCol = col >> inGrid->cellShift;
+  size_t cellRow = row >> inGrid->cellShift;
+
+  if (cellCol >= inGrid->gridWidth)
+  {
+    cellCol = inGrid->gridWidth - 1;
+  }
+
+  if (cellRow >= inGrid->gridHeight)
+  {
+    cellRow = inGrid->gridHeight - 1;
+  }
+
+  return cellRow * inGrid->gridWidth + cellCol;
+}
+
+
+/*
+ * Range of grid cells overlapping a square window around a point
+ *
+ */
+static void PointGridRange (size_t            *outCol0,
+                            size_t            *outRow0,
+                            size_t            *outCol1,  /* inclusive */
+                            size_t            *outRow1,  /* inclusive */
+                            const PointGrid_t *inGrid,
+                            const size_t       col,
+                            const size_t       row,
+                            const size_t       radius)
+{
+  const size_t shift = inGrid->cellShift;
+
+  *outCol0 = ((col > radius) ? col - radius : 0) >> shift;
+  *outRow0 = ((row > radius) ? row - radius : 0) >> shift;
+  *outCol1 = (col + radius) >> shift;
+  *outRow1 = (row + radius) >> shift;
+
+  if (*outCol1 >= inGrid->gridWidth)
+  {
+    *outCol1 = inGrid->gridWidth - 1;
+  }
+
+  if (*outRow1 >= inGrid->gridHeight)
+  {
+    *outRow1 = inGrid->gridHeight - 1;
+  }
+
+  if (*outCol0 > *outCol1)
+  {
+    *outCol0 = *outCol1;
+  }
+
+  if (*outRow0 > *outRow1)
+  {
+    *outRow0 = *outRow1;
+  }
+}
+
+
+/*
+ * Build a uniform grid index over a set of points
+ *
+ * The grid is a bucket sort of the points by cell. The cells are square with
+ * sides of 2^cellShift pixels. Queries look at every cell overlapping a
+ * square window around the query point. So the best cell size is about the
+ * same as the query radius.
+ *
+ * Building is a counting sort which is linear in the number of points plus
+ * the number of cells. The point coordinate arrays are referenced, not
+ * copied, so they must remain valid while the grid is in use.
+ *
+ */
+void PointGridBuild (PointGrid_t  *outGrid,
+                     const size_t *inCol,
+                     const size_t *inRow,
+                     const size_t  numPoints)
+{
+  const size_t numCells = outGrid->gridWidth * outGrid->gridHeight;
+
+  size_t *cellStart = outGrid->cellStart;
+
+  size_t i, cell;
+
+  outGrid->pointCol     = inCol;
+  outGrid->pointRow     = inRow;
+  outGrid->numberPoints = numPoints;
+
+  /* count points in every cell */
+  memset(cellStart, 0, sizeof(size_t) * (numCells + 1));
+
+  for (i = 0; i < numPoints; ++i)
+  {
+    cellStart[ PointGridCell(outGrid, inCol[i], inRow[i]) ]++;
+  }
+
+  /* cumulative counts are the end of every cell */
+  for (i = 1; i < numCells; ++i)
+  {
+    cellStart[i] += cellStart[i - 1];
+  }
+
+  cellStart[numCells] = numPoints;
+
+  /* place points from the back so the order within a cell is preserved */
+  for (i = numPoints; i > 0; --i)
+  {
+    cell = PointGridCell(outGrid, inCol[i - 1], inRow[i - 1]);
+    outGrid->cellPoints[ --cellStart[cell] ] = i - 1;
+  }
+}
+
+
+/*
+ * Count the points closer than the radius to a location
+ *
+ * A point exactly at the location is included in the count.
+ *
+ */
+size_t PointGridCount (const PointGrid_t *inGrid,
+                       const size_t       col,
+                       const size_t       row,
+                       const size_t       radius)
+{
+  const size_t  radiusSq = radius * radius;
+  const size_t *ptrCol   = inGrid->pointCol;
+  const size_t *ptrRow   = inGrid->pointRow;
+
+  size_t col0, row0, col1, row1, cellRow, cell, i, idx;
+  size_t colDist, rowDist;
+  size_t count = 0;
+
+  PointGridRange(&col0, &row0, &col1, &row1, inGrid, col, row, radius);
+
+  for (cellRow = row0; cellRow <= row1; ++cellRow)
+  {
+    for (cell = cellRow * inGrid->gridWidth + col0;
+         cell <= cellRow * inGrid->gridWidth + col1;
+         ++cell)
+    {
+      for (i = inGrid->cellStart[cell]; i < inGrid->cellStart[cell + 1]; ++i)
+      {
+        idx     = inGrid->cellPoints[i];
+        colDist = UINTDIFF(col, ptrCol[idx]);
+        rowDist = UINTDIFF(row, ptrRow[idx]);
+
+        if (colDist * colDist + rowDist * rowDist < radiusSq)
+        {
+          count++;
+        }
+      }
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Find the points closer than the radius to a location
+ *
+ * The indices of the points are written to the output array. At most
+ * maxIndex points are written. The total number of points found is returned
+ * which may be more than maxIndex.
+ *
+ */
+size_t PointGridQuery (size_t            *outIndex,
+                       const size_t       maxIndex,
+                       const PointGrid_t *inGrid,
+                       const size_t       col,
+                       const size_t       row,
+                       const size_t       radius)
+{
+  const size_t  radiusSq = radius * radius;
+  const size_t *ptrCol   = inGrid->pointCol;
+  const size_t *ptrRow   = inGrid->pointRow;
+
+  size_t col0, row0, col1, row1, cellRow, cell, i, idx;
+  size_t colDist, rowDist;
+  size_t count = 0;
+
+  PointGridRange(&col0, &row0, &col1, &row1, inGrid, col, row, radius);
+
+  for (cellRow = row0; cellRow <= row1; ++cellRow)
+  {
+    for (cell = cellRow * inGrid->gridWidth + col0;
+         cell <= cellRow * inGrid->gridWidth + col1;
+         ++cell)
+    {
+      for (i = inGrid->cellStart[cell]; i < inGrid->cellStart[cell + 1]; ++i)
+      {
+        idx     = inGrid->cellPoints[i];
+        colDist = UINTDIFF(col, ptrCol[idx]);
+        rowDist = UINTDIFF(row, ptrRow[idx]);
+
+        if (colDist * colDist + rowDist * rowDist < radiusSq)
+        {
+          if (count < maxIndex)
+          {
+            outIndex[count] = idx;
+          }
+          count++;
+        }
+      }
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Greedy non-maximum suppression of points
+ *
+ * The candidate points are visited in the order given. Typically this is
+ * sorted by decreasing strength. A candidate still active is kept and then
+ * every point closer than the radius, including itself, is made inactive.
+ * The kept point indices are written to the output array and the number
+ * kept is returned.
+ *
+ * The output array may be the same as the candidate array. The temporary
+ * array needs one element for every point in the grid.
+ *
+ */
+size_t PointGridSuppress (size_t            *outIndex,
+                          uint8_t           *tmpActive,
+                          const PointGrid_t *inGrid,
+                          const size_t      *inCandidates,
+                          const size_t       numCandidates,
+                          const size_t       radius)
+{
+  const size_t  radiusSq = radius * radius;
+  const size_t *ptrCol   = inGrid->pointCol;
+  const size_t *ptrRow   = inGrid->pointRow;
+
+  size_t col0, row0, col1, row1, cellRow, cell, i, idx, n;
+  size_t col, row, colDist, rowDist;
+  size_t count = 0;
+
+  memset(tmpActive, 1, sizeof(uint8_t) * inGrid->numberPoints);
+
+  for (n = 0; n < numCandidates; ++n)
+  {
+    idx = inCandidates[n];
+
+    if (! tmpActive[idx])
+    {
+      continue;
+    }
+
+    outIndex[count++] = idx;
+
+    col = ptrCol[idx];
+    row = ptrRow[idx];
+
+    PointGridRange(&col0, &row0, &col1, &row1, inGrid, col, row, radius);
+
+    for (cellRow = row0; cellRow <= row1; ++cellRow)
+    {
+      for (cell = cellRow * inGrid->gridWidth + col0;
+           cell <= cellRow * inGrid->gridWidth + col1;
+           ++cell)
+      {
+        for (i = inGrid->cellStart[cell];
+             i < inGrid->cellStart[cell + 1];
+             ++i)
+        {
+          idx     = inGrid->cellPoints[i];
+          colDist = UINTDIFF(col, ptrCol[idx]);
+          rowDist = UINTDIFF(row, ptrRow[idx]);
+
+          if (colDist * colDist + rowDist * rowDist < radiusSq)
+          {
+            tmpActive[idx] = 0;
+          }
+        }
+      }
+    }
+
+    tmpActive[ inCandidates[n] ] = 0;
+  }
+
+  return count;
+}
@@ -0,0 +1,293 @@
+/*
+ * EmbedCV - an embeddable computer vision library
+ *
+ * Copyright (C) 2006  Chris Jang
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ *
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Email the author: cjang@ix.netcom.com
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#include "embedcv.h"
+
+
+/*
+ * Reduce an image to half size by averaging 2x2 blocks
+ *
+ */
+static void ReduceImageBox (Image8_t       *outImg,
+                            const Image8_t *inImg)
+{
+  const size_t inWidth = inImg->width;
+
+  const uint8_t *ptrInUp;
+  const uint8_t *ptrInDown;
+  uint8_t       *ptrOut = outImg->data;
+
+  size_t row;
+
+  for (row = 0; row < outImg->height; ++row)
+  {
+    ptrInUp   = inImg->data + (row << 1) * inWidth;
+    ptrInDown = ptrInUp + inWidth;
+
+    UNROLL_LOOP( outImg->width,
+
+        *ptrOut++ = (ptrInUp[0] + ptrInUp[1]
+                     + ptrInDown[0] + ptrInDown[1] + 2) >> 2;
+        ptrInUp   += 2;
+        ptrInDown += 2;
+    )
+  }
+}
+
+
+/*
+ * Reduce an image to half size with the 5 tap binomial filter 1 4 6 4 1
+ *
+ * The filter is separable. Five input rows are filtered vertically into a
+ * row of sums and then every other column of sums is filtered horizontally.
+ * Pixels beyond the border repeat the border pixels.
+ *
+ */
+static void ReduceImageGauss5 (Image8_t       *outImg,
+                               const Image8_t *inImg)
+{
+  const size_t inWidth  = inImg->width;
+  const size_t inHeight = inImg->height;
+  const size_t lastCol  = inWidth - 1;
+
+  /* vertical sums with two repeated border columns on each side */
+  uint16_t sums[inWidth + 4];
+
+  const uint8_t *ptrIn[5];
+  uint16_t      *ptrSum;
+  uint8_t       *ptrOut = outImg->data;
+
+  size_t row, col, i;
+  long   inRow;
+
+  for (row = 0; row < outImg->height; ++row)
+  {
+    for (i = 0; i < 5; ++i)
+    {
+      inRow = (long)(row << 1) + (long)i - 2;
+
+      if (inRow < 0)
+      {
+        inRow = 0;
+      }
+      else if (inRow >= (long)inHeight)
+      {
+        inRow = inHeight - 1;
+      }
+
+      ptrIn[i] = inImg->data + inRow * inWidth;
+    }
+
+    ptrSum = sums + 2;
+
+    for (col = 0; col < inWidth; ++col)
+    {
+      *ptrSum++ = ptrIn[0][col] + ptrIn[4][col]
+                  + ((ptrIn[1][col] + ptrIn[3][col]) << 2)
+                  + ptrIn[2][col] * 6;
+    }
+
+    sums[0]           = sums[1]           = sums[2];
+    sums[inWidth + 2] = sums[inWidth + 3] = sums[lastCol + 2];
+
+    ptrSum = sums;
+
+    UNROLL_LOOP( outImg->width,
+
+        *ptrOut++ = (ptrSum[0] + ptrSum[4]
+                     + ((ptrSum[1] + ptrSum[3]) << 2)
+                     + ptrSum[2] * 6 + 128) >> 8;
+        ptrSum += 2;
+    )
+  }
+}
+
+
+/*
+ * Reduce an image to half size with anti-aliasing
+ *
+ * Unlike DownsampleImage() which only subsamples, the image is low pass
+ * filtered first. The box filter averages 2x2 blocks which is fast. The 5
+ * tap filter is the Gaussian-like kernel from:
+ *
+ * The Laplacian Pyramid as a Compact Image Code
+ * by Peter J. Burt and Edward H. Adelson
+ * IEEE Transactions on Communications, 1983
+ *
+ * The output image should be half the input width and height, rounded down.
+ *
+ */
+void ReduceImage (Image8_t               *outImg,
+                  const Image8_t         *inImg,
+                  const EcvPyramidFilter  filter)
+{
+  if (filter == ECV_PYRAMID_GAUSS5)
+  {
+    ReduceImageGauss5(outImg, inImg);
+  }
+  else
+  {
+    ReduceImageBox(outImg, inImg);
+  }
+}
+
+
+/*
+ * Storage needed for the reduced levels of an image pyramid
+ *
+ * Level 0 is the base image which is referenced and not stored. Levels stop
+ * at ECV_PYRAMID_MAX_LEVELS or when either dimension would become zero, the
+ * same as ImagePyramidInit().
+ *
+ */
+size_t ImagePyramidBufferSize (const size_t width,
+                               const size_t height,
+                               const size_t numLevels)
+{
+  size_t levelWidth  = width >> 1;
+  size_t levelHeight = height >> 1;
+  size_t level, size = 0;
+
+  for (level = 1;
+       (level < numLevels) && (level < ECV_PYRAMID_MAX_LEVELS)
+       && levelWidth && levelHeight;
+       ++level)
+  {
+    size        += levelWidth * levelHeight;
+    levelWidth  >>= 1;
+    levelHeight >>= 1;
+  }
+
+  return size;
+}
+
+
+/*
+ * Set up an image pyramid in a buffer
+ *
+ * Every level is half the width and height of the level below it. The level
+ * images are views into one buffer of ImagePyramidBufferSize() bytes. A pixel
+ * at column and row in level L covers the base image pixels from column << L
+ * and row << L. There are at most ECV_PYRAMID_MAX_LEVELS levels and fewer
+ * for small images. The actual number of levels is returned.
+ *
+ */
+size_t ImagePyramidInit (ImagePyramid_t         *outPyramid,
+                         uint8_t                *inBuffer,
+                         const size_t            width,
+                         const size_t            height,
+                         const size_t            numLevels,
+                         const EcvPyramidFilter  filter)
+{
+  Image8_t *ptrLevel = outPyramid->levels;
+
+  size_t level;
+
+  outPyramid->buffer      = inBuffer;
+  outPyramid->filter      = filter;
+  outPyramid->builtLevels = 0;  /* no base image yet */
+
+  /* the base image is set for every frame */
+  ptrLevel->data   = 0;
+  ptrLevel->width  = width;
+  ptrLevel->height = height;
+
+  for (level = 1;
+       (level < numLevels) && (level < ECV_PYRAMID_MAX_LEVELS)
+       && (ptrLevel->width >> 1) && (ptrLevel->height >> 1);
+       ++level)
+  {
+    ptrLevel[1].data   = level > 1
+                             ? ptrLevel->data + ptrLevel->width
+                                                * ptrLevel->height
+                             : inBuffer;
+    ptrLevel[1].width  = ptrLevel->width >> 1;
+    ptrLevel[1].height = ptrLevel->height >> 1;
+    ptrLevel++;
+  }
+
+  return outPyramid->numberLevels = level;
+}
+
+
+/*
+ * Start a new frame of an image pyramid
+ *
+ * The image becomes the base level. It is referenced, not copied, so it must
+ * remain unchanged while the pyramid is in use for this frame. All cached
+ * reduced levels are invalidated.
+ *
+ */
+void ImagePyramidSetBase (ImagePyramid_t *inoutPyramid,
+                          const Image8_t *inImg)
+{
+  /* the base level is only ever read */
+  inoutPyramid->levels[0].data = (uint8_t *) inImg->data;
+  inoutPyramid->builtLevels    = 1;
+}
+
+
+/*
+ * Get a level of an image pyramid, building it first if needed
+ *
+ * Levels are built on first access by reducing the level below, which is
+ * built first if needed too. They are cached until the next frame so any
+ * number of consumers can share them. Asking for a level beyond the top
+ * gives the top level. Before the first ImagePyramidSetBase() there is
+ * nothing to build from so null is returned.
+ *
+ */
+const Image8_t *ImagePyramidLevel (ImagePyramid_t *inoutPyramid,
+                                   const size_t    level)
+{
+  const size_t top = (level < inoutPyramid->numberLevels)
+                         ? level
+                         : inoutPyramid->numberLevels - 1;
+
+  Image8_t *levels = inoutPyramid->levels;
+
+  if (! inoutPyramid->builtLevels)
+  {
+    return 0;
+  }
+
+  while (inoutPyramid->builtLevels <= top)
+  {
+    ReduceImage(levels + inoutPyramid->builtLevels,
+                levels + inoutPyramid->builtLevels - 1,
+                inoutPyramid->filter);
+
+    inoutPyramid->builtLevels++;
+  }
+
+  return levels + top;
+}